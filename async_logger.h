@@ -0,0 +1,250 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+enum class LogMode {
+    OFF,
+    // one line of space separated values per record
+    TEXT,
+    // per record: uint32 frame, uint32 count, then count floats, native endian
+    BINARY,
+};
+
+// logs buffers of floats off the render thread. the render thread copies
+// values into a single producer single consumer ring and returns straight
+// away, a writer thread formats and writes them out. the ring is made on the
+// first record, big enough for a few of them, so any buffer size can be
+// logged. if the writer can't keep up records are dropped rather than
+// blocking the caller, and the drops are reported as they happen
+class AsyncLogger {
+public:
+    // only log every nth call
+    unsigned int every;
+    // only log every nth value within a buffer
+    unsigned int stride;
+
+    // ring_bytes is the smallest ring, it grows to fit RECORDS_IN_FLIGHT of
+    // the first record
+    AsyncLogger( LogMode mode, const char* path = NULL, size_t ring_bytes = 1 << 22 ) {
+        this->mode = mode;
+        this->ring_bytes = ring_bytes;
+        every = 1;
+        stride = 1;
+        calls = 0;
+        dropped = 0;
+        reported = 0;
+        head = 0;
+        tail = 0;
+        capacity = 0;
+        running = false;
+        stopped = false;
+        warned_size = false;
+        out = &std::cout;
+
+        if ( mode == LogMode::OFF ) {
+            return;
+        }
+
+        if ( path != NULL ) {
+            file.open( path, mode == LogMode::BINARY ? std::ios::binary | std::ios::trunc : std::ios::trunc );
+            if ( !file.is_open() ) {
+                std::cerr << "failed to open log file " << path << ", logging to stdout" << std::endl;
+            } else {
+                out = &file;
+            }
+        }
+    }
+
+    ~AsyncLogger() {
+        stop();
+    }
+
+    // copy a buffer into the ring, subject to every/stride. never blocks
+    void log_values( uint32_t frame, const float* values, size_t count ) {
+        if ( mode == LogMode::OFF || stopped || calls++ % every != 0 ) {
+            return;
+        }
+
+        uint32_t sampled = (uint32_t) ( ( count + stride - 1 ) / stride );
+        size_t record_bytes = HEADER_BYTES + sampled * sizeof(float);
+
+        if ( !running ) {
+            start( record_bytes );
+        }
+
+        size_t write_pos = head.load( std::memory_order_relaxed );
+        size_t read_pos = tail.load( std::memory_order_acquire );
+        if ( capacity - ( write_pos - read_pos ) < record_bytes ) {
+            // a record bigger than the whole ring can never go in, say so
+            // once rather than quietly dropping every one of them
+            if ( record_bytes > capacity && !warned_size ) {
+                warned_size = true;
+                std::cerr << "logger: " << record_bytes << " byte record is bigger than the " << capacity << " byte ring, records of this size are dropped" << std::endl;
+            }
+            dropped++;
+            report_drops( false );
+            return;
+        }
+
+        write_bytes( write_pos, &frame, sizeof(frame) );
+        write_bytes( write_pos + sizeof(frame), &sampled, sizeof(sampled) );
+
+        size_t pos = write_pos + HEADER_BYTES;
+        if ( stride == 1 ) {
+            write_bytes( pos, values, count * sizeof(float) );
+        } else {
+            for ( size_t i = 0; i < count; i += stride ) {
+                write_bytes( pos, &values[ i ], sizeof(float) );
+                pos += sizeof(float);
+            }
+        }
+
+        head.store( write_pos + record_bytes, std::memory_order_release );
+    }
+
+    // write out whatever is left and join the writer
+    void stop() {
+        stopped = true;
+        if ( !running ) {
+            return;
+        }
+
+        running = false;
+        writer.join();
+        out->flush();
+        report_drops( true );
+    }
+
+private:
+    static const size_t HEADER_BYTES = 2 * sizeof(uint32_t);
+    // records the first one sizes the ring for, so the writer can fall a
+    // little behind without anything being dropped
+    static const size_t RECORDS_IN_FLIGHT = 4;
+    static const int REPORT_INTERVAL_MS = 1000;
+
+    LogMode mode;
+    std::ostream* out;
+    std::ofstream file;
+
+    std::vector<unsigned char> ring;
+    size_t ring_bytes;
+    size_t capacity;
+    // both only ever increase, masked when indexing into the ring
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+
+    std::thread writer;
+    std::atomic<bool> running;
+    bool stopped;
+    bool warned_size;
+    unsigned int calls;
+    unsigned int dropped;
+    // drops already printed, and when
+    unsigned int reported;
+    std::chrono::steady_clock::time_point last_report;
+
+    void start( size_t record_bytes ) {
+        // round up to a power of two so positions can wrap with a mask
+        size_t wanted = std::max( ring_bytes, RECORDS_IN_FLIGHT * record_bytes );
+        capacity = 1;
+        while ( capacity < wanted ) {
+            capacity <<= 1;
+        }
+        ring.resize( capacity );
+
+        last_report = std::chrono::steady_clock::now();
+        running = true;
+        writer = std::thread( &AsyncLogger::writer_loop, this );
+    }
+
+    // prints drops since the last report, at most once a second while
+    // running so a full ring shows up during the run and not just at exit
+    void report_drops( bool final ) {
+        if ( dropped == reported ) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if ( !final && now - last_report < std::chrono::milliseconds( (int) REPORT_INTERVAL_MS ) ) {
+            return;
+        }
+
+        std::cerr << "logger dropped " << dropped - reported << " records, ring was full";
+        if ( final ) {
+            std::cerr << " (" << dropped << " in total)";
+        }
+        std::cerr << std::endl;
+        reported = dropped;
+        last_report = now;
+    }
+
+    void write_bytes( size_t pos, const void* src, size_t count ) {
+        size_t offset = pos & ( capacity - 1 );
+        size_t first = std::min( count, capacity - offset );
+        memcpy( &ring[ offset ], src, first );
+        memcpy( &ring[ 0 ], (const unsigned char*) src + first, count - first );
+    }
+
+    void read_bytes( size_t pos, void* dst, size_t count ) {
+        size_t offset = pos & ( capacity - 1 );
+        size_t first = std::min( count, capacity - offset );
+        memcpy( dst, &ring[ offset ], first );
+        memcpy( (unsigned char*) dst + first, &ring[ 0 ], count - first );
+    }
+
+    void writer_loop() {
+        std::vector<float> values;
+
+        while ( true ) {
+            // read running before head so a record published right before
+            // stop() is still written
+            bool keep_going = running;
+            size_t write_pos = head.load( std::memory_order_acquire );
+            size_t read_pos = tail.load( std::memory_order_relaxed );
+
+            if ( read_pos == write_pos ) {
+                if ( !keep_going ) {
+                    return;
+                }
+                out->flush();
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                continue;
+            }
+
+            while ( read_pos != write_pos ) {
+                uint32_t frame, count;
+                read_bytes( read_pos, &frame, sizeof(frame) );
+                read_bytes( read_pos + sizeof(frame), &count, sizeof(count) );
+
+                values.resize( count );
+                read_bytes( read_pos + HEADER_BYTES, values.data(), count * sizeof(float) );
+                read_pos += HEADER_BYTES + count * sizeof(float);
+
+                // hand the space back before the slow part
+                tail.store( read_pos, std::memory_order_release );
+
+                if ( mode == LogMode::BINARY ) {
+                    out->write( (const char*) &frame, sizeof(frame) );
+                    out->write( (const char*) &count, sizeof(count) );
+                    out->write( (const char*) values.data(), count * sizeof(float) );
+                } else {
+                    for ( auto v : values ) {
+                        *out << v << " ";
+                    }
+                    *out << "\n";
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -5,21 +5,26 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
 #include "shader.h"
+#include "framebuffer.h"
 #include "dan_math.h"
 
+// move only, the gl objects are owned by their handles
 class BatchRenderer {
 public:
     BatchRenderer() {
         // create our vertex buffer and array objects
-        glGenBuffers( 1, &vbo );
-        glGenBuffers( 1, &ebo );
-        glGenVertexArrays( 1, &vao );
+        vbo = make_buffer( "batch renderer vbo" );
+        ebo = make_buffer( "batch renderer ebo" );
+        vao = make_vertex_array();
 
-        // bind the vbo, ebo, and vao
-        glBindBuffer( GL_ARRAY_BUFFER, vbo );
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
-        glBindVertexArray( vao );
+        // bind the vao first so it captures the ebo, then the vbo for the attributes
+        gl_state().bind_vertex_array( vao.get() );
+        gl_state().bind_buffer( GL_ELEMENT_ARRAY_BUFFER, ebo.get() );
+        gl_state().bind_buffer( GL_ARRAY_BUFFER, vbo.get() );
 
         // set attributes
         // position
@@ -30,12 +35,13 @@ public:
         glEnableVertexAttribArray( 1 );
 
         square_count = 0;
+        target = NULL;
     }
 
-    ~BatchRenderer() {
-        glDeleteBuffers( 1, &vbo );
-        glDeleteBuffers( 1, &ebo );
-        glDeleteVertexArrays( 1, &vao );
+    // draw into an offscreen framebuffer instead of the window, NULL goes
+    // back to the default framebuffer
+    void set_target( Framebuffer* framebuffer ) {
+        target = framebuffer;
     }
 
     void clear( glm::vec3 color ) {
@@ -45,6 +51,7 @@ public:
         square_count = 0;
 
         // clear the screen
+        bind_target();
         glClearColor( color.r, color.g, color.b, 1.0f );
         glClear( GL_COLOR_BUFFER_BIT );
     }
@@ -72,29 +79,37 @@ public:
     }
 
     void render( Shader* shader ) {
+        bind_target();
         shader->use();
 
-        // send data to gl
-        auto vbo_ptr = vbo_data.data();
-        glBindBuffer( GL_ARRAY_BUFFER, vbo );
-        glBufferData( GL_ARRAY_BUFFER, sizeof(vbo_ptr) * vbo_data.size(), vbo_ptr, GL_DYNAMIC_DRAW );
+        // the ebo is part of the vao's state, so bind that first
+        gl_state().bind_vertex_array( vao.get() );
 
-        auto ebo_ptr = ebo_data.data();
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
-        glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof(ebo_ptr) * ebo_data.size(), ebo_ptr, GL_DYNAMIC_DRAW );
+        // send data to gl
+        gpu_memory().buffer_data( GL_ARRAY_BUFFER, vbo.get(), sizeof(float) * vbo_data.size(), vbo_data.data(), GL_DYNAMIC_DRAW );
+        gpu_memory().buffer_data( GL_ELEMENT_ARRAY_BUFFER, ebo.get(), sizeof(unsigned int) * ebo_data.size(), ebo_data.data(), GL_DYNAMIC_DRAW );
 
         // actually render
-        glBindVertexArray( vao );
         glDrawElements( GL_TRIANGLES, ebo_data.size(), GL_UNSIGNED_INT, NULL );
     }
 
 private:
-    const unsigned int stride = 5 * sizeof(float); // vec2 pos, vec3 color
+    static const unsigned int stride = 5 * sizeof(float); // vec2 pos, vec3 color
 
-    unsigned int vbo, ebo, vao;
+    BufferHandle vbo, ebo;
+    VertexArrayHandle vao;
     std::vector<float> vbo_data;
     std::vector<unsigned int> ebo_data;
     unsigned int square_count;
+    Framebuffer* target;
+
+    void bind_target() {
+        if ( target != NULL ) {
+            target->bind();
+        } else {
+            gl_state().bind_framebuffer( GL_FRAMEBUFFER, 0 );
+        }
+    }
 
     void push_vert( float x, float y, float r, float g, float b ) {
         // coords are in ndc
@@ -0,0 +1,978 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <glad/glad.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "reduce.h"
+#include "scan.h"
+#include "radix_sort.h"
+#include "compaction.h"
+#include "compute.h"
+#include "compute_graph.h"
+#include "dan_math.h"
+#include "fixed_timestep.h"
+#include "stream_executor.h"
+#include "mapped_file.h"
+#include "storage_buffer.h"
+
+// gpu primitive benchmarks. each one checks its output against a plain cpu
+// version first, then times repeated runs, and returns how many checks
+// failed so they double as a smoke test. `--bench all` runs every one and
+// exits non-zero if anything failed
+
+// seconds per call of run, averaged over `iterations` back to back calls.
+// wall clock around a glFinish rather than a timer query, since software
+// drivers like llvmpipe only do the work at the sync point
+template <typename F>
+double time_gpu( unsigned int iterations, F run ) {
+    // warm up, first dispatches include driver compile and allocation work
+    run();
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < iterations; i++ ) {
+        run();
+    }
+    glFinish();
+
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() / iterations;
+}
+
+template <typename F>
+double time_cpu( F run ) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+bool close_enough( double expected, double actual, double tolerance ) {
+    return std::fabs( expected - actual ) <= tolerance * std::max( 1.0, std::fabs( expected ) );
+}
+
+// one named check. returns the failures it adds, and says what failed
+size_t check( bool ok, const char* what ) {
+    if ( !ok ) {
+        std::cout << "  mismatch: " << what << "\n";
+    }
+    return ok ? 0 : 1;
+}
+
+// a gpu result against its cpu reference, element by element. a failure
+// reports how many elements differ and the first of them
+template <typename T, typename U, typename Match>
+size_t check_values( const char* what, const std::vector<T>& expected, const std::vector<U>& actual, Match match ) {
+    if ( actual.size() != expected.size() ) {
+        std::cout << "  mismatch: " << what << " has " << actual.size() << " values, expected "
+            << expected.size() << "\n";
+        return 1;
+    }
+
+    size_t wrong = 0, first = 0;
+    for ( size_t i = 0; i < expected.size(); i++ ) {
+        if ( !match( expected[ i ], actual[ i ] ) ) {
+            first = wrong == 0 ? i : first;
+            wrong++;
+        }
+    }
+
+    if ( wrong > 0 ) {
+        std::cout << "  mismatch: " << what << ", " << wrong << " of " << expected.size() << " values differ, first at "
+            << first << ": expected " << expected[ first ] << ", got " << actual[ first ] << "\n";
+    }
+    return wrong > 0 ? 1 : 0;
+}
+
+template <typename T>
+size_t check_values( const char* what, const std::vector<T>& expected, const std::vector<T>& actual ) {
+    return check_values( what, expected, actual, []( const T& a, const T& b ) { return a == b; } );
+}
+
+template <typename T, typename U>
+size_t check_close( const char* what, const std::vector<T>& expected, const std::vector<U>& actual, double tolerance ) {
+    return check_values( what, expected, actual, [ & ]( const T& a, const U& b ) {
+        return close_enough( a, b, tolerance );
+    } );
+}
+
+// the verdict line every benchmark ends on, passes the failures through
+int report( size_t failures ) {
+    if ( failures == 0 ) {
+        std::cout << "  PASS" << std::endl;
+    } else {
+        std::cout << "  FAIL: " << failures << " check" << ( failures == 1 ? "" : "s" )
+            << " did not match the cpu reference" << std::endl;
+    }
+    return (int) failures;
+}
+
+int benchmark_reduce( size_t size ) {
+    std::vector<float> values( size );
+    std::mt19937 rng( 1234 );
+    std::uniform_real_distribution<float> dist( -1.0f, 1.0f );
+    for ( auto& v : values ) {
+        v = dist( rng );
+    }
+
+    StorageBuffer input( "reduce benchmark input", size * sizeof(float), values.data() );
+    Reduction reduction;
+
+    // cpu reference, summed in double so it's the more accurate of the two
+    double expected_sum = 0.0;
+    float expected_min = std::numeric_limits<float>::infinity();
+    float expected_max = -std::numeric_limits<float>::infinity();
+    double cpu_seconds = time_cpu( [ & ] {
+        for ( float v : values ) {
+            expected_sum += v;
+            expected_min = std::min( expected_min, v );
+            expected_max = std::max( expected_max, v );
+        }
+    } );
+
+    float sum = reduction.sum( input, size );
+    float min = reduction.min( input, size );
+    float max = reduction.max( input, size );
+    float mean = reduction.mean( input, size );
+
+    // float accumulation error grows with size, allow for it on sum/mean.
+    // an empty input reduces to 0 for every op
+    double tolerance = 1e-5 * std::sqrt( (double) size );
+    size_t failures = 0;
+    if ( size == 0 ) {
+        failures += check( sum == 0.0f && min == 0.0f && max == 0.0f && mean == 0.0f, "empty input" );
+    } else {
+        failures += check( close_enough( expected_sum, sum, tolerance ), "sum" );
+        failures += check( min == expected_min, "min" );
+        failures += check( max == expected_max, "max" );
+        failures += check( close_enough( expected_sum / size, mean, tolerance ), "mean" );
+    }
+
+    std::cout << "reduce " << size << " floats (" << ( reduction.subgroups ? "subgroups" : "shared memory" ) << ")\n";
+    std::cout << "  sum " << sum << " (cpu " << expected_sum << "), min " << min << " (cpu " << expected_min
+        << "), max " << max << " (cpu " << expected_max << "), mean " << mean << "\n";
+
+    double gpu_seconds = time_gpu( 20, [ & ] { reduction.run( ReduceOp::SUM, input, size ); } );
+    double bytes = size * sizeof(float);
+    std::cout << "  gpu sum: " << gpu_seconds * 1000.0 << "ms, " << bytes / gpu_seconds / 1e9 << " GB/s\n";
+    std::cout << "  cpu sum/min/max: " << cpu_seconds * 1000.0 << "ms, " << bytes / cpu_seconds / 1e9 << " GB/s\n";
+
+    return report( failures );
+}
+
+int benchmark_scan( size_t size ) {
+    std::mt19937 rng( 1234 );
+    std::uniform_int_distribution<unsigned int> uint_dist( 0, 15 );
+    std::uniform_real_distribution<float> float_dist( 0.0f, 1.0f );
+
+    std::vector<unsigned int> uints( size );
+    std::vector<float> floats( size );
+    for ( size_t i = 0; i < size; i++ ) {
+        uints[ i ] = uint_dist( rng );
+        floats[ i ] = float_dist( rng );
+    }
+
+    StorageBuffer uint_input( "scan benchmark uint input", size * sizeof(unsigned int), uints.data() );
+    StorageBuffer float_input( "scan benchmark float input", size * sizeof(float), floats.data() );
+    StorageBuffer output( "scan benchmark output", size * sizeof(unsigned int) );
+    PrefixScan scan;
+
+    // uints are exact, check both flavours against std
+    std::vector<unsigned int> expected( size );
+    double cpu_seconds = time_cpu( [ & ] {
+        std::inclusive_scan( uints.begin(), uints.end(), expected.begin() );
+    } );
+    scan.inclusive_scan( ScanType::UINT, uint_input, output, size );
+    size_t failures = check_values( "uint inclusive scan", expected, output.read<unsigned int>( size ) );
+
+    std::exclusive_scan( uints.begin(), uints.end(), expected.begin(), 0u );
+    scan.exclusive_scan( ScanType::UINT, uint_input, output, size );
+    failures += check_values( "uint exclusive scan", expected, output.read<unsigned int>( size ) );
+
+    // floats are summed in a different order, compare against a double
+    // reference with a tolerance
+    scan.inclusive_scan( ScanType::FLOAT, float_input, output, size );
+    std::vector<double> float_expected( size );
+    std::inclusive_scan( floats.begin(), floats.end(), float_expected.begin(), std::plus<double>(), 0.0 );
+    failures += check_close( "float inclusive scan", float_expected, output.read<float>( size ), 1e-4 );
+
+    std::cout << "scan " << size << " elements\n";
+
+    double bytes = size * sizeof(unsigned int) * 2.0;
+    double gpu_seconds = time_gpu( 10, [ & ] { scan.inclusive_scan( ScanType::UINT, uint_input, output, size ); } );
+    std::cout << "  gpu uint inclusive: " << gpu_seconds * 1000.0 << "ms, " << size / gpu_seconds / 1e6
+        << " M elements/s, " << bytes / gpu_seconds / 1e9 << " GB/s\n";
+    gpu_seconds = time_gpu( 10, [ & ] { scan.inclusive_scan( ScanType::FLOAT, float_input, output, size ); } );
+    std::cout << "  gpu float inclusive: " << gpu_seconds * 1000.0 << "ms, " << size / gpu_seconds / 1e6
+        << " M elements/s, " << bytes / gpu_seconds / 1e9 << " GB/s\n";
+    std::cout << "  cpu std::inclusive_scan: " << cpu_seconds * 1000.0 << "ms, " << size / cpu_seconds / 1e6
+        << " M elements/s\n";
+
+    return report( failures );
+}
+
+// std::sort on one chunk per hardware thread, then pairwise merges of
+// neighbouring chunks, also in parallel
+void parallel_sort( std::vector<unsigned int>& values ) {
+    size_t chunks = std::max( 1u, std::thread::hardware_concurrency() );
+    size_t chunk_size = ( values.size() + chunks - 1 ) / chunks;
+    auto chunk_begin = [ & ]( size_t chunk ) {
+        return values.begin() + std::min( chunk * chunk_size, values.size() );
+    };
+
+    std::vector<std::thread> threads;
+    for ( size_t c = 0; c < chunks; c++ ) {
+        threads.emplace_back( [ &, c ] { std::sort( chunk_begin( c ), chunk_begin( c + 1 ) ); } );
+    }
+    for ( auto& t : threads ) {
+        t.join();
+    }
+
+    for ( size_t width = 1; width < chunks; width *= 2 ) {
+        threads.clear();
+        for ( size_t c = 0; c + width < chunks; c += width * 2 ) {
+            threads.emplace_back( [ &, c, width ] {
+                std::inplace_merge( chunk_begin( c ), chunk_begin( c + width ), chunk_begin( c + width * 2 ) );
+            } );
+        }
+        for ( auto& t : threads ) {
+            t.join();
+        }
+    }
+}
+
+int benchmark_sort( size_t size ) {
+    std::mt19937 rng( 1234 );
+    std::vector<unsigned int> keys( size );
+    std::vector<unsigned int> values( size );
+    for ( size_t i = 0; i < size; i++ ) {
+        keys[ i ] = rng();
+        values[ i ] = (unsigned int) i;
+    }
+
+    StorageBuffer key_buffer( "sort benchmark keys", size * sizeof(unsigned int), keys.data() );
+    StorageBuffer value_buffer( "sort benchmark values", size * sizeof(unsigned int), values.data() );
+    RadixSort sort;
+
+    // the value is each key's original index, so a stable sort's pairs
+    // can be checked against std::stable_sort of the indices
+    sort.sort_pairs( key_buffer, value_buffer, size );
+    std::vector<unsigned int> expected_values( values );
+    std::stable_sort( expected_values.begin(), expected_values.end(), [ & ]( unsigned int a, unsigned int b ) {
+        return keys[ a ] < keys[ b ];
+    } );
+    size_t failures = check_values( "sorted pair values", expected_values, value_buffer.read<unsigned int>( size ) );
+
+    std::vector<unsigned int> expected( keys );
+    double std_seconds = time_cpu( [ & ] { std::sort( expected.begin(), expected.end() ); } );
+    failures += check_values( "sorted keys", expected, key_buffer.read<unsigned int>( size ) );
+
+    std::vector<unsigned int> parallel( keys );
+    double parallel_seconds = time_cpu( [ & ] { parallel_sort( parallel ); } );
+    failures += check_values( "parallel cpu sort", expected, parallel );
+
+    // time from unsorted input each run
+    StorageBuffer unsorted( "sort benchmark unsorted", size * sizeof(unsigned int), keys.data() );
+    double keys_seconds = time_gpu( 5, [ & ] {
+        copy_buffer( unsorted, key_buffer, size * sizeof(unsigned int) );
+        sort.sort( key_buffer, size );
+    } );
+    double pairs_seconds = time_gpu( 5, [ & ] {
+        copy_buffer( unsorted, key_buffer, size * sizeof(unsigned int) );
+        sort.sort_pairs( key_buffer, value_buffer, size );
+    } );
+
+    std::cout << "radix sort " << size << " keys\n";
+    std::cout << "  gpu keys: " << keys_seconds * 1000.0 << "ms, " << size / keys_seconds / 1e6 << " M keys/s\n";
+    std::cout << "  gpu pairs: " << pairs_seconds * 1000.0 << "ms, " << size / pairs_seconds / 1e6 << " M pairs/s\n";
+    std::cout << "  std::sort: " << std_seconds * 1000.0 << "ms, " << size / std_seconds / 1e6 << " M keys/s\n";
+    std::cout << "  parallel cpu sort (" << std::thread::hardware_concurrency() << " threads): "
+        << parallel_seconds * 1000.0 << "ms, " << size / parallel_seconds / 1e6 << " M keys/s\n";
+
+    return report( failures );
+}
+
+int benchmark_compact( size_t size ) {
+    std::mt19937 rng( 1234 );
+    std::uniform_real_distribution<float> dist( -1.0f, 1.0f );
+    std::vector<float> values( size );
+    for ( auto& v : values ) {
+        v = dist( rng );
+    }
+
+    StorageBuffer input( "compact benchmark input", size * sizeof(float), values.data() );
+    StorageBuffer output( "compact benchmark output", std::max( size, (size_t) 1 ) * sizeof(float) );
+    StorageBuffer args = StreamCompaction::make_args( "compact benchmark args" );
+    StreamCompaction compaction( "value > 0.0" );
+
+    std::vector<float> expected;
+    double cpu_seconds = time_cpu( [ & ] {
+        std::copy_if( values.begin(), values.end(), std::back_inserter( expected ), []( float v ) { return v > 0.0f; } );
+    } );
+
+    compaction.compact( input, output, args, size );
+    CompactionArgs result;
+    args.download( &result, sizeof(result) );
+
+    unsigned int groups = (unsigned int) ( expected.size() + 255 ) / 256;
+    size_t failures = check( result.kept == expected.size(), "kept count" );
+    failures += check( result.dispatch[ 0 ] == groups && result.dispatch[ 1 ] == 1 && result.dispatch[ 2 ] == 1,
+        "dispatch args" );
+    failures += check( result.draw[ 0 ] == expected.size() && result.draw[ 1 ] == 1, "draw args" );
+    failures += check_values( "kept values", expected, output.read<float>( expected.size() ) );
+
+    // a follow-up kernel sized on the gpu from the args, it should launch
+    // whole groups covering the kept elements and touch only those
+    ComputeProgram follow_up( "double_kept.comp" );
+    unsigned int zero[ 2 ] = { 0, 0 };
+    StorageBuffer counters( "compact benchmark counters", sizeof(zero), zero );
+    follow_up.use();
+    output.bind_base( 1 );
+    args.bind_base( 3 );
+    counters.bind_base( 4 );
+    follow_up.dispatch_indirect( args, offsetof( CompactionArgs, dispatch ) );
+    glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+
+    std::vector<unsigned int> counted = counters.read<unsigned int>( 2 );
+    std::vector<float> doubled( expected );
+    for ( auto& v : doubled ) {
+        v *= 2.0f;
+    }
+    failures += check( counted[ 0 ] == groups * follow_up.local_size.x, "indirect dispatch group count" );
+    failures += check( counted[ 1 ] == expected.size(), "indirect dispatch touched exactly the kept elements" );
+    failures += check_values( "values after the indirect dispatch", doubled, output.read<float>( expected.size() ) );
+
+    std::cout << "compact " << size << " floats, kept " << result.kept << " (cpu " << expected.size() << "), "
+        << "indirect dispatch launched " << counted[ 0 ] << " and touched " << counted[ 1 ] << "\n";
+
+    double gpu_seconds = time_gpu( 10, [ & ] { compaction.compact( input, output, args, size ); } );
+    std::cout << "  gpu: " << gpu_seconds * 1000.0 << "ms, " << size / gpu_seconds / 1e6 << " M elements/s\n";
+    std::cout << "  cpu std::copy_if: " << cpu_seconds * 1000.0 << "ms, " << size / cpu_seconds / 1e6
+        << " M elements/s\n";
+
+    return report( failures );
+}
+
+// three chained scans through transient buffers plus one pass nothing
+// reads, so the graph should cull one pass and alias the first and third
+// transients onto the same memory
+int benchmark_graph( size_t size ) {
+    std::vector<unsigned int> ones( size, 1 );
+    StorageBuffer input( "graph benchmark input", size * sizeof(unsigned int), ones.data() );
+    StorageBuffer output( "graph benchmark output", size * sizeof(unsigned int) );
+    PrefixScan scan;
+    ComputeGraph graph;
+
+    auto build = [ & ] {
+        size_t bytes = size * sizeof(unsigned int);
+        graph.reset();
+        auto in = graph.import_buffer( "input", input );
+        auto out = graph.import_buffer( "output", output );
+        auto a = graph.create_buffer( "a", bytes );
+        auto b = graph.create_buffer( "b", bytes );
+        auto c = graph.create_buffer( "c", bytes );
+        auto unused = graph.create_buffer( "unused", bytes );
+
+        graph.add_pass( "scan a", [ & ] { scan.inclusive_scan( ScanType::UINT, input, graph.buffer( a ), size ); } )
+            .read( in, Access::STORAGE ).write( a, Access::STORAGE );
+        graph.add_pass( "unused", [ & ] { scan.inclusive_scan( ScanType::UINT, input, graph.buffer( unused ), size ); } )
+            .read( in, Access::STORAGE ).write( unused, Access::STORAGE );
+        graph.add_pass( "scan b", [ & ] { scan.inclusive_scan( ScanType::UINT, graph.buffer( a ), graph.buffer( b ), size ); } )
+            .read( a, Access::STORAGE ).write( b, Access::STORAGE );
+        graph.add_pass( "scan c", [ & ] { scan.inclusive_scan( ScanType::UINT, graph.buffer( b ), graph.buffer( c ), size ); } )
+            .read( b, Access::STORAGE ).write( c, Access::STORAGE );
+        graph.add_pass( "copy out", [ & ] { copy_buffer( graph.buffer( c ), output, bytes ); } )
+            .read( c, Access::TRANSFER ).write( out, Access::TRANSFER );
+        graph.output( out, Access::TRANSFER );
+        graph.execute();
+    };
+
+    std::vector<unsigned int> expected( ones );
+    for ( int i = 0; i < 3; i++ ) {
+        std::inclusive_scan( expected.begin(), expected.end(), expected.begin() );
+    }
+
+    build();
+    size_t failures = check_values( "graph output", expected, output.read<unsigned int>( size ) );
+
+    std::cout << "graph of 3 chained scans over " << size << " elements\n";
+    double gpu_seconds = time_gpu( 10, build );
+    std::cout << "  gpu: " << gpu_seconds * 1000.0 << "ms per graph\n  ";
+    graph.print_summary( std::cout );
+
+    return report( failures );
+}
+
+// the render loop's interpolation with the simulation at 4x the render
+// rate, so most frames run several steps. shader.comp adds one per step,
+// so blending the last two states should land on exactly the step count
+// interpolated_time() implies, not up to three steps behind it
+int benchmark_timestep( size_t size ) {
+    const double render_rate = 60.0;
+    const double sim_rate = render_rate * 4.0;
+    const unsigned int frames = 240;
+    unsigned int width = (unsigned int) std::min( std::max( size, (size_t) 1 ), (size_t) 1024 );
+    unsigned int height = (unsigned int) ( ( std::max( size, (size_t) 1 ) + width - 1 ) / width );
+
+    Compute compute( "shader.comp", glm::uvec2( width, height ), true );
+    std::vector<float> initial( compute.count() );
+    for ( size_t i = 0; i < initial.size(); i++ ) {
+        initial[ i ] = (float) ( i % 100 );
+    }
+    compute.use();
+    compute.set_values( initial.data() );
+
+    FixedTimestep timestep( sim_rate, 8 );
+    std::vector<StepParams> params( timestep.max_steps );
+    std::vector<float> previous( initial ), current( initial );
+
+    // frame times jitter around the render rate, so alpha takes all sorts
+    // of values and the steps per frame vary
+    std::mt19937 rng( 1234 );
+    std::uniform_real_distribution<double> jitter( 0.7, 1.3 );
+
+    bool ok = true;
+    double worst = 0.0;
+    unsigned int multi_step_frames = 0;
+    double seconds = time_cpu( [ & ] {
+        for ( unsigned int frame = 0; frame < frames; frame++ ) {
+            unsigned int steps = timestep.advance( jitter( rng ) / render_rate );
+            if ( steps > 0 ) {
+                compute.submit_steps( params.data(), steps );
+                compute.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+                previous = compute.get_previous_values();
+                current = compute.get_values();
+            }
+            multi_step_frames += steps > 1 ? 1 : 0;
+
+            float alpha = timestep.alpha();
+            double expected = timestep.interpolated_time() * sim_rate;
+            ok = ok && previous.size() == initial.size() && current.size() == initial.size();
+            for ( size_t i = 0; i < initial.size() && ok; i++ ) {
+                double error = std::fabs( lerp( previous[ i ], current[ i ], alpha ) - initial[ i ] - expected );
+                worst = std::max( worst, error );
+                ok = error < 1e-3;
+            }
+        }
+    } );
+
+    std::cout << frames << " frames at " << render_rate << "hz, simulation at " << sim_rate << "hz over "
+        << compute.count() << " elements\n";
+    std::cout << "  " << multi_step_frames << " frames ran more than one step, worst error " << worst
+        << " steps\n";
+    std::cout << "  " << seconds * 1000.0 / frames << "ms per frame for the steps and both readbacks\n";
+
+    return report( check( ok, "interpolated values against interpolated_time()" ) );
+}
+
+// k steps of shader.comp the way main.cpp used to run them, use, dispatch
+// and a full barrier per step, against one submit_steps batch
+int benchmark_steps( size_t size ) {
+    const unsigned int steps = 64;
+    unsigned int width = (unsigned int) std::min( std::max( size, (size_t) 1 ), (size_t) 1024 );
+    unsigned int height = (unsigned int) ( ( std::max( size, (size_t) 1 ) + width - 1 ) / width );
+
+    Compute compute( "shader.comp", glm::uvec2( width, height ), true );
+    std::vector<float> initial( compute.count(), 0.0f );
+    std::vector<StepParams> params( steps );
+    for ( unsigned int i = 0; i < steps; i++ ) {
+        params[ i ] = { i / 60.0f, 1.0f / 60.0f, i, 0 };
+    }
+
+    auto per_call = [ & ] {
+        for ( unsigned int i = 0; i < steps; i++ ) {
+            compute.use();
+            compute.dispatch();
+            compute.swap();
+            compute.wait();
+        }
+    };
+    auto batched = [ & ] {
+        compute.submit_steps( params.data(), steps );
+        compute.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+    };
+
+    // every step adds one to every value
+    auto values = [ & ] {
+        compute.use();
+        return compute.get_values();
+    };
+
+    compute.use();
+    compute.set_values( initial.data() );
+    per_call();
+    size_t failures = check_values( "per call steps", std::vector<float>( initial.size(), (float) steps ), values() );
+    batched();
+    failures += check_values( "batched steps", std::vector<float>( initial.size(), (float) steps * 2 ), values() );
+
+    std::cout << steps << " steps of shader.comp over " << compute.count() << " elements\n";
+    double per_call_seconds = time_gpu( 5, per_call );
+    double batched_seconds = time_gpu( 5, batched );
+    std::cout << "  per call: " << per_call_seconds * 1000.0 << "ms, " << steps / per_call_seconds << " steps/s\n";
+    std::cout << "  batched: " << batched_seconds * 1000.0 << "ms, " << steps / batched_seconds << " steps/s\n";
+
+    return report( failures );
+}
+
+// one storage format through shader.comp: upload, 16 steps, read back,
+// every channel should have gone up by 16
+template <typename T>
+size_t benchmark_format( const char* name, ComputeFormat format, glm::uvec2 size ) {
+    const unsigned int steps = 16;
+    Compute compute( "shader.comp", size, true, format );
+
+    // small integers, exact in every format including r16f
+    std::vector<T> initial( compute.count() * compute.channels() );
+    for ( size_t i = 0; i < initial.size(); i++ ) {
+        initial[ i ] = (T) ( i % 1000 );
+    }
+
+    compute.use();
+    compute.set_values( initial.data() );
+    compute.step( steps );
+    compute.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+
+    std::vector<T> expected( initial );
+    for ( auto& v : expected ) {
+        v += (T) steps;
+    }
+    size_t failures = check_values( name, expected, compute.get_values<T>() );
+
+    double seconds = time_gpu( 5, [ & ] { compute.step( steps ); } ) / steps;
+    double bytes = 2.0 * compute.count() * compute.texel_bytes();
+    std::cout << "  " << name << ": " << compute.texel_bytes() << " bytes/texel, " << seconds * 1000.0
+        << "ms per step, " << bytes / seconds / 1e9 << " GB/s\n";
+
+    return failures;
+}
+
+int benchmark_formats( size_t size ) {
+    unsigned int width = (unsigned int) std::min( std::max( size, (size_t) 1 ), (size_t) 1024 );
+    glm::uvec2 grid( width, (unsigned int) ( ( std::max( size, (size_t) 1 ) + width - 1 ) / width ) );
+
+    std::cout << "compute storage formats over " << grid.x * grid.y << " texels\n";
+    size_t failures = benchmark_format<float>( "r32f", ComputeFormat::R32F, grid );
+    failures += benchmark_format<float>( "r16f", ComputeFormat::R16F, grid );
+    failures += benchmark_format<float>( "rg32f", ComputeFormat::RG32F, grid );
+    failures += benchmark_format<float>( "rgba32f", ComputeFormat::RGBA32F, grid );
+    failures += benchmark_format<unsigned int>( "r32ui", ComputeFormat::R32UI, grid );
+    failures += benchmark_format<int>( "r32i", ComputeFormat::R32I, grid );
+
+    return report( failures );
+}
+
+// combine.comp reads its state, a second Compute's image, a storage
+// buffer and a uniform block. checks the binding table's validation too
+int benchmark_bindings( size_t size ) {
+    unsigned int width = (unsigned int) std::min( std::max( size, (size_t) 1 ), (size_t) 1024 );
+    glm::uvec2 grid( width, (unsigned int) ( ( std::max( size, (size_t) 1 ) + width - 1 ) / width ) );
+
+    Compute combine( "combine.comp", grid, true );
+    Compute other( "shader.comp", grid, true );
+    size_t count = combine.count();
+
+    std::vector<float> state( count ), other_values( count ), offsets( count );
+    for ( size_t i = 0; i < count; i++ ) {
+        state[ i ] = (float) ( i % 100 );
+        other_values[ i ] = (float) ( i % 7 );
+        offsets[ i ] = (float) ( i % 3 );
+    }
+    float scale[ 4 ] = { 2.0f, 0.0f, 0.0f, 0.0f };
+
+    other.use();
+    other.set_values( other_values.data() );
+    combine.use();
+    combine.set_values( state.data() );
+    StorageBuffer offset_buffer( "bindings benchmark offsets", count * sizeof(float), offsets.data() );
+    StorageBuffer scale_buffer( "bindings benchmark scale", sizeof(scale), scale );
+
+    // textures that don't fit combine.comp's r32f image2D at binding 2
+    Compute volume( "diffuse.comp", glm::uvec3( 2, 2, 2 ) );
+    Compute integers( "shader.comp", grid, true, ComputeFormat::R32UI );
+
+    // nothing attached yet, then attachments the kernel doesn't declare or
+    // that don't match its declaration
+    std::cerr << "bindings benchmark: the next eight errors are expected" << std::endl;
+    size_t failures = check( !combine.check_bindings(), "missing attachments reported" );
+    failures += check( !combine.attach_storage( 3, offset_buffer ), "undeclared storage block rejected" );
+    failures += check( !combine.attach_image( 0, other.out_tex.get(), GL_R32F ), "state image binding rejected" );
+    failures += check( !combine.attach_image( 2, other.out_tex.get(), GL_RG32F ), "wrong format rejected" );
+    failures += check( !combine.attach_image( 2, volume.out_tex.get(), GL_R32F ), "3d texture for an image2D rejected" );
+    failures += check( !combine.attach_image( 2, integers.out_tex.get(), GL_R32UI ), "r32ui texture for a float image rejected" );
+
+    failures += check( combine.attach_image( 2, other.out_tex.get(), GL_R32F ), "image attached" );
+    failures += check( combine.attach_storage( 0, offset_buffer ), "storage block attached" );
+    failures += check( combine.attach_uniform( 0, scale_buffer ), "uniform block attached" );
+    failures += check( combine.check_bindings(), "every binding attached" );
+
+    // the other kernel's use() takes over the shared binding points,
+    // combine's use() has to put its own back
+    other.use();
+    combine.use();
+    combine.dispatch();
+    combine.swap();
+    combine.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+
+    std::vector<float> expected( count );
+    for ( size_t i = 0; i < count; i++ ) {
+        expected[ i ] = state[ i ] + other_values[ i ] * scale[ 0 ] + offsets[ i ];
+    }
+    failures += check_values( "combined values", expected, combine.get_values() );
+
+    std::cout << "binding table over " << count << " texels\n";
+    double seconds = time_gpu( 10, [ & ] {
+        combine.use();
+        combine.dispatch();
+        combine.swap();
+    } );
+    std::cout << "  use + dispatch: " << seconds * 1000.0 << "ms\n";
+
+    return report( failures );
+}
+
+// a few steps of diffuse.comp against the same stencil on the cpu, over a
+// volume or, with a depth of 1, a plane
+size_t benchmark_diffusion( glm::ivec3 dims ) {
+    const unsigned int steps = 4;
+    const float rate = 0.1f;
+    int dimensions = dims.z > 1 ? 3 : 2;
+    size_t cells = (size_t) dims.x * dims.y * dims.z;
+
+    std::mt19937 rng( 1234 );
+    std::uniform_real_distribution<float> dist( 0.0f, 1.0f );
+    std::vector<float> initial( cells );
+    for ( auto& v : initial ) {
+        v = dist( rng );
+    }
+
+    Compute state( "diffuse.comp", glm::uvec3( dims ), true );
+    state.use();
+    state.set_float( "rate", rate );
+    state.set_values( initial.data() );
+    state.step( steps );
+    state.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+    std::vector<float> result = state.get_values();
+
+    // same stencil, same order of additions
+    std::vector<float> current( initial ), next( cells );
+    auto at = [ & ]( glm::ivec3 pos ) {
+        pos = glm::clamp( pos, glm::ivec3( 0 ), dims - 1 );
+        return current[ ( (size_t) pos.z * dims.y + pos.y ) * dims.x + pos.x ];
+    };
+    double cpu_seconds = time_cpu( [ & ] {
+        for ( unsigned int s = 0; s < steps; s++ ) {
+            for ( int z = 0; z < dims.z; z++ ) {
+                for ( int y = 0; y < dims.y; y++ ) {
+                    for ( int x = 0; x < dims.x; x++ ) {
+                        glm::ivec3 pos( x, y, z );
+                        float centre = at( pos );
+                        float sum = 0.0f;
+                        for ( int axis = 0; axis < dimensions; axis++ ) {
+                            glm::ivec3 step( 0 );
+                            step[ axis ] = 1;
+                            sum += at( pos - step );
+                            sum += at( pos + step );
+                        }
+                        next[ ( (size_t) z * dims.y + y ) * dims.x + x ] = centre + rate * ( sum - 2.0f * dimensions * centre );
+                    }
+                }
+            }
+            current.swap( next );
+        }
+    } ) / steps;
+
+    size_t failures = check_close( dimensions == 3 ? "diffused volume" : "diffused plane", current, result, 1e-5 );
+
+    // the local size follows the state's dimensions, a plane shouldn't
+    // launch a z it then skips
+    glm::uvec3 local = state.program.local_size;
+    failures += check( dimensions == 3 || local.z == 1, "local size z of 1 for a plane" );
+
+    std::cout << "diffusion over a " << dims.x << "x" << dims.y << "x" << dims.z << ( dimensions == 3 ? " volume" : " plane" )
+        << ", local size " << local.x << "x" << local.y << "x" << local.z << "\n";
+    double gpu_seconds = time_gpu( 5, [ & ] { state.step( steps ); } ) / steps;
+    std::cout << "  gpu: " << gpu_seconds * 1000.0 << "ms per step, " << cells / gpu_seconds / 1e6 << " M cells/s\n";
+    std::cout << "  cpu: " << cpu_seconds * 1000.0 << "ms per step, " << cells / cpu_seconds / 1e6 << " M cells/s\n";
+
+    return failures;
+}
+
+// a cube of roughly size cells, then a square plane of as many
+int benchmark_volume( size_t size ) {
+    int edge = std::max( 1, (int) std::round( std::cbrt( (double) size ) ) );
+    size_t failures = benchmark_diffusion( glm::ivec3( edge, edge, std::max( edge, 2 ) ) );
+
+    int side = std::max( 1, (int) std::round( std::sqrt( (double) size ) ) );
+    failures += benchmark_diffusion( glm::ivec3( side, side, 1 ) );
+
+    return report( failures );
+}
+
+// batches of varying size through one resized Compute against building a
+// new Compute per batch, which compiles the kernel every time
+int benchmark_resize( size_t size ) {
+    const int batches = 20;
+    std::mt19937 rng( 1234 );
+    std::uniform_int_distribution<size_t> dist( std::max( size / 2, (size_t) 1 ), std::max( size, (size_t) 1 ) );
+    std::vector<glm::uvec2> sizes;
+    for ( int i = 0; i < batches; i++ ) {
+        size_t texels = dist( rng );
+        unsigned int width = (unsigned int) std::min( texels, (size_t) 1024 );
+        sizes.push_back( glm::uvec2( width, ( texels + width - 1 ) / width ) );
+    }
+
+    // every batch steps its values once, so each should come back plus one
+    auto run_batch = [ & ]( Compute& compute, const char* what ) {
+        std::vector<float> values( compute.count() ), expected( compute.count() );
+        for ( size_t i = 0; i < values.size(); i++ ) {
+            values[ i ] = (float) ( i % 1000 );
+            expected[ i ] = values[ i ] + 1.0f;
+        }
+        compute.use();
+        compute.set_values( values.data() );
+        compute.step( 1 );
+        compute.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+
+        return check_values( what, expected, compute.get_values() );
+    };
+
+    size_t failures = 0;
+    Compute resized( "shader.comp", sizes[ 0 ], true );
+    double resize_seconds = time_cpu( [ & ] {
+        for ( auto& s : sizes ) {
+            failures += check( resized.resize( s ), "resize" );
+            failures += run_batch( resized, "batch after a resize" );
+        }
+        glFinish();
+    } );
+
+    double recreate_seconds = time_cpu( [ & ] {
+        for ( auto& s : sizes ) {
+            Compute compute( "shader.comp", s, true );
+            failures += run_batch( compute, "batch in a new Compute" );
+        }
+        glFinish();
+    } );
+
+    glm::uvec3 storage = resized.storage_size();
+    std::cout << batches << " batches of " << size / 2 << " to " << size << " texels\n";
+    std::cout << "  resize: " << resize_seconds * 1000.0 / batches << "ms per batch, " << resized.reallocations
+        << " reallocations, storage " << storage.x << "x" << storage.y << "\n";
+    std::cout << "  new Compute per batch: " << recreate_seconds * 1000.0 / batches << "ms per batch\n";
+
+    return report( failures );
+}
+
+// size floats through shader.comp in 16 chunks, pipelined across the
+// executor's three slots against one Compute doing upload, step and
+// readback for each chunk in turn
+int benchmark_stream( size_t size ) {
+    const unsigned int steps = 4;
+    std::vector<float> input( size ), output( size ), serial_output( size );
+    for ( size_t i = 0; i < size; i++ ) {
+        input[ i ] = (float) ( i % 1000 );
+    }
+
+    StreamExecutor executor( "shader.comp", std::max( size / 16, (size_t) 1 ), steps );
+    size_t chunk = executor.chunk_texels();
+    double stream_seconds = time_cpu( [ & ] { executor.run( input.data(), output.data(), size ); } );
+
+    Compute serial( "shader.comp", glm::uvec2( 1024, chunk / 1024 ), true );
+    std::vector<float> staging( chunk );
+    double serial_seconds = time_cpu( [ & ] {
+        for ( size_t first = 0; first < size; first += chunk ) {
+            size_t count = std::min( chunk, size - first );
+            std::copy( input.begin() + first, input.begin() + first + count, staging.begin() );
+            serial.use();
+            serial.set_values( staging.data() );
+            serial.step( steps );
+            serial.wait( GL_TEXTURE_UPDATE_BARRIER_BIT );
+            std::vector<float> values = serial.get_values();
+            std::copy( values.begin(), values.begin() + count, serial_output.begin() + first );
+        }
+    } );
+
+    std::vector<float> expected( size );
+    for ( size_t i = 0; i < size; i++ ) {
+        expected[ i ] = input[ i ] + steps;
+    }
+    size_t failures = check_values( "pipelined output", expected, output );
+    failures += check_values( "serial output", expected, serial_output );
+
+    double bytes = size * sizeof(float) * 2.0;
+    std::cout << "stream " << size << " floats in chunks of " << chunk << ", " << steps << " steps each\n";
+    std::cout << "  pipelined: " << stream_seconds * 1000.0 << "ms, " << bytes / stream_seconds / 1e9 << " GB/s, "
+        << executor.fence_waits << " fence waits\n";
+    std::cout << "  serial: " << serial_seconds * 1000.0 << "ms, " << bytes / serial_seconds / 1e9 << " GB/s\n";
+
+    return report( failures );
+}
+
+// an empty file made with mkstemp, so concurrent runs each get their own
+// and nothing can be swapped in for it through a symlink. removed again
+// when this goes out of scope
+struct TempFile {
+    std::string path;
+    bool created;
+
+    TempFile( const char* name ) {
+        std::string pattern = std::string( P_tmpdir ) + "/opengl_compute_" + name + "_XXXXXX";
+        std::vector<char> buffer( pattern.begin(), pattern.end() );
+        buffer.push_back( '\0' );
+
+        int fd = mkstemp( buffer.data() );
+        created = fd >= 0;
+        if ( created ) {
+            ::close( fd );
+            path = buffer.data();
+        } else {
+            std::cerr << "can't create a temporary file from " << pattern << ": " << strerror( errno ) << std::endl;
+        }
+    }
+
+    ~TempFile() {
+        if ( created ) {
+            unlink( path.c_str() );
+        }
+    }
+
+    const char* c_str() {
+        return path.c_str();
+    }
+};
+
+// a file of size floats through shader.comp to another file, mapped on
+// both ends against reading it into a std::vector and writing one back out.
+// then an input that isn't a whole number of floats, which stream_file
+// should refuse
+int benchmark_mmap( size_t size ) {
+    const unsigned int steps = 1;
+    TempFile input_path( "mmap_in" ), mapped_path( "mmap_out" ), vector_path( "vector_out" );
+    if ( !input_path.created || !mapped_path.created || !vector_path.created ) {
+        return report( check( false, "temporary files created" ) );
+    }
+
+    {
+        MappedFile input;
+        if ( !input.create( input_path.c_str(), size * sizeof(float) ) ) {
+            return report( check( false, "input file created" ) );
+        }
+        float* values = input.as<float>();
+        for ( size_t i = 0; i < size; i++ ) {
+            values[ i ] = (float) ( i % 1000 );
+        }
+    }
+
+    StreamExecutor executor( "shader.comp", std::max( size / 16, (size_t) 1 ), steps );
+
+    // warm up, first dispatches include driver compile work
+    float warm_up[ 2 ] = { 0.0f, 0.0f };
+    executor.run( warm_up, warm_up + 1, 1 );
+    glFinish();
+
+    bool streamed = false;
+    double mapped_seconds = time_cpu( [ & ] {
+        streamed = stream_file( executor, input_path.c_str(), mapped_path.c_str() );
+    } );
+    size_t failures = check( streamed, "stream_file" );
+
+    double vector_seconds = time_cpu( [ & ] {
+        std::vector<float> input( size ), output( size );
+        std::ifstream in( input_path.path, std::ios::binary );
+        in.read( (char*) input.data(), size * sizeof(float) );
+        executor.run( input.data(), output.data(), size );
+        std::ofstream out( vector_path.path, std::ios::binary );
+        out.write( (const char*) output.data(), size * sizeof(float) );
+    } );
+
+    std::vector<float> expected( size );
+    for ( size_t i = 0; i < size; i++ ) {
+        expected[ i ] = (float) ( i % 1000 ) + steps;
+    }
+    auto read_back = [ & ]( TempFile& file ) {
+        MappedFile result;
+        result.open_read( file.c_str() );
+        const float* values = result.as<float>();
+        return std::vector<float>( values, values + result.size() / sizeof(float) );
+    };
+    failures += check_values( "mapped output file", expected, read_back( mapped_path ) );
+    failures += check_values( "std::vector output file", expected, read_back( vector_path ) );
+
+    // one byte short of a whole float
+    {
+        MappedFile ragged;
+        ragged.create( input_path.c_str(), sizeof(float) * 2 + 3 );
+    }
+    std::cerr << "mmap benchmark: the next error is expected" << std::endl;
+    failures += check( !stream_file( executor, input_path.c_str(), mapped_path.c_str() ), "partial float rejected" );
+
+    double bytes = size * sizeof(float) * 2.0;
+    std::cout << "file to file, " << size << " floats through shader.comp\n";
+    std::cout << "  mapped: " << mapped_seconds * 1000.0 << "ms, " << bytes / mapped_seconds / 1e9 << " GB/s\n";
+    std::cout << "  via std::vector: " << vector_seconds * 1000.0 << "ms, " << bytes / vector_seconds / 1e9 << " GB/s\n";
+
+    return report( failures );
+}
+
+struct Benchmark {
+    const char* name;
+    int (*run)( size_t size );
+};
+
+const Benchmark BENCHMARKS[] = {
+    { "reduce", benchmark_reduce },
+    { "scan", benchmark_scan },
+    { "sort", benchmark_sort },
+    { "compact", benchmark_compact },
+    { "graph", benchmark_graph },
+    { "timestep", benchmark_timestep },
+    { "steps", benchmark_steps },
+    { "formats", benchmark_formats },
+    { "bindings", benchmark_bindings },
+    { "volume", benchmark_volume },
+    { "resize", benchmark_resize },
+    { "stream", benchmark_stream },
+    { "mmap", benchmark_mmap },
+};
+
+// one benchmark by name, or "all" of them. returns the checks that failed,
+// or -1 for an unknown name
+int run_benchmark( const char* name, size_t size ) {
+    bool all = strcmp( name, "all" ) == 0;
+    int failures = 0;
+    int ran = 0;
+
+    for ( const Benchmark& benchmark : BENCHMARKS ) {
+        if ( all || strcmp( name, benchmark.name ) == 0 ) {
+            failures += benchmark.run( size );
+            ran++;
+        }
+    }
+
+    if ( ran == 0 ) {
+        std::cerr << "unknown benchmark: " << name << std::endl;
+        return -1;
+    }
+
+    if ( all ) {
+        std::cout << ran << " benchmarks, " << failures << " failed checks" << std::endl;
+    }
+    return failures;
+}
+
+#endif
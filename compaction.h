@@ -0,0 +1,122 @@
+#ifndef COMPACTION_H
+#define COMPACTION_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "compute.h"
+#include "compute_program.h"
+#include "scan.h"
+#include "storage_buffer.h"
+
+// layout of the args buffer a compaction writes. bind it to
+// GL_DISPATCH_INDIRECT_BUFFER and pass offsetof( CompactionArgs, dispatch )
+// to glDispatchComputeIndirect, or to GL_DRAW_INDIRECT_BUFFER with
+// offsetof( CompactionArgs, draw ) for glDrawArraysIndirect
+struct CompactionArgs {
+    unsigned int kept;
+    // num_groups_x, y, z
+    unsigned int dispatch[ 3 ];
+    // count, instance count, first, base instance
+    unsigned int draw[ 4 ];
+};
+
+// keeps the floats a predicate is true for, packed to the front of the
+// output in their original order. the number kept only ever lives on the
+// gpu, in a CompactionArgs buffer, unless the caller reads it back
+class StreamCompaction {
+public:
+    // predicate is a glsl expression over `value`, e.g. "value > 0.0".
+    // indirect_local_size is the local size of whatever kernel gets
+    // dispatched from the args, one invocation per kept element
+    StreamCompaction( const std::string& predicate, unsigned int indirect_local_size = 256 )
+        : flags_pass( "compact.comp", defines( "PASS_FLAGS", predicate ) ),
+          scatter_pass( "compact.comp", defines( "PASS_SCATTER", predicate ) ),
+          offsets( "compaction offsets", sizeof(unsigned int) ),
+          staging( "compaction staging", 0 ),
+          indirect_local_size( indirect_local_size ) {
+    }
+
+    // a buffer to hand to compact() for its args
+    static StorageBuffer make_args( const std::string& label ) {
+        return StorageBuffer( label, sizeof(CompactionArgs) );
+    }
+
+    // output needs room for count floats, the worst case. when this
+    // returns the args are safe to use for indirect dispatch or draw
+    void compact( StorageBuffer& input, StorageBuffer& output, StorageBuffer& args, size_t count ) {
+        if ( count == 0 ) {
+            // nothing runs, so nothing would write the args
+            CompactionArgs empty = { 0, { 0, 1, 1 }, { 0, 1, 0, 0 } };
+            args.upload( &empty, sizeof(empty) );
+            return;
+        }
+
+        if ( offsets.size < count * sizeof(unsigned int) ) {
+            offsets = StorageBuffer( "compaction offsets", count * sizeof(unsigned int) );
+        }
+
+        size_t blocks = ( count + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+
+        flags_pass.use();
+        input.bind_base( 0 );
+        offsets.bind_base( 2 );
+        flags_pass.set_uint( "count", (unsigned int) count );
+        flags_pass.set_uint( "block_count", (unsigned int) blocks );
+        flags_pass.dispatch_groups( blocks );
+        glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+
+        scan.exclusive_scan( ScanType::UINT, offsets, offsets, count );
+
+        scatter_pass.use();
+        input.bind_base( 0 );
+        output.bind_base( 1 );
+        offsets.bind_base( 2 );
+        args.bind_base( 3 );
+        scatter_pass.set_uint( "count", (unsigned int) count );
+        scatter_pass.set_uint( "block_count", (unsigned int) blocks );
+        scatter_pass.set_uint( "indirect_local_size", indirect_local_size );
+        scatter_pass.dispatch_groups( blocks );
+        glMemoryBarrier( GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+    }
+
+    // compact a float Compute's values, every channel as its own element.
+    // call wait() after its dispatch first
+    void compact( Compute& compute, StorageBuffer& output, StorageBuffer& args ) {
+        size_t count = compute.count() * compute.channels();
+        if ( staging.size < count * sizeof(float) ) {
+            staging = StorageBuffer( "compaction staging", count * sizeof(float) );
+        }
+
+        compute.copy_to( staging );
+        compact( staging, output, args, count );
+    }
+
+    // blocks on the gpu, for debugging and the benchmark
+    static unsigned int read_kept( StorageBuffer& args ) {
+        unsigned int kept = 0;
+        args.download( &kept, sizeof(kept), offsetof( CompactionArgs, kept ) );
+        return kept;
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 256;
+
+    ComputeProgram flags_pass;
+    ComputeProgram scatter_pass;
+    PrefixScan scan;
+    // one flag per element, scanned into output offsets in place
+    StorageBuffer offsets;
+    // Compute values copied into a buffer, empty until compacting one
+    StorageBuffer staging;
+    unsigned int indirect_local_size;
+
+    static std::string defines( const char* pass, const std::string& predicate ) {
+        return std::string( "#define " ) + pass + " 1\n#define PREDICATE( value ) ( " + predicate + " )\n";
+    }
+};
+
+#endif
@@ -4,101 +4,626 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include <string>
-#include <fstream>
+#include "compute_program.h"
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "storage_buffer.h"
+
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
+// storage formats for Compute state. float formats are set and read as
+// floats (r16f is converted by gl on the way in and out), integer ones as
+// unsigned int or int
+enum class ComputeFormat {
+    R32F,
+    R16F,
+    RG32F,
+    RGBA32F,
+    R32UI,
+    R32I,
+};
+
+struct ComputeFormatInfo {
+    GLenum internal_format;
+    // client side layout for uploads and readbacks
+    GLenum pixel_format;
+    GLenum type;
+    unsigned int channels;
+    // handed to the kernel as STATE_FORMAT, STATE_IMAGE and STATE_VEC,
+    // the image type gets 2D or 3D added
+    const char* glsl_format;
+    const char* glsl_image;
+    const char* glsl_vec;
+};
+
+ComputeFormatInfo compute_format_info( ComputeFormat format ) {
+    switch ( format ) {
+        case ComputeFormat::R32F: return { GL_R32F, GL_RED, GL_FLOAT, 1, "r32f", "image", "vec4" };
+        case ComputeFormat::R16F: return { GL_R16F, GL_RED, GL_FLOAT, 1, "r16f", "image", "vec4" };
+        case ComputeFormat::RG32F: return { GL_RG32F, GL_RG, GL_FLOAT, 2, "rg32f", "image", "vec4" };
+        case ComputeFormat::RGBA32F: return { GL_RGBA32F, GL_RGBA, GL_FLOAT, 4, "rgba32f", "image", "vec4" };
+        case ComputeFormat::R32UI: return { GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, 1, "r32ui", "uimage", "uvec4" };
+        case ComputeFormat::R32I: return { GL_R32I, GL_RED_INTEGER, GL_INT, 1, "r32i", "iimage", "ivec4" };
+    }
+    return compute_format_info( ComputeFormat::R32F );
+}
+
+// the gl type matching a c++ element type, for checking typed set/get
+template <typename T> GLenum client_type();
+template <> GLenum client_type<float>() { return GL_FLOAT; }
+template <> GLenum client_type<unsigned int>() { return GL_UNSIGNED_INT; }
+template <> GLenum client_type<int>() { return GL_INT; }
+
+// per step parameters for a batch of steps, std430 layout. a kernel reads
+// its own with params[ step ]:
+//
+//   struct StepParams { float time; float dt; uint index; uint pad; };
+//   layout(std430, binding = 7) readonly buffer Steps { StepParams params[]; };
+//   uniform uint step;
+struct StepParams {
+    float time;
+    float dt;
+    unsigned int index;
+    unsigned int pad;
+};
+
+// move only, the gl objects are owned by their handles
+//
+// single buffered, the kernel updates image binding 0 in place, which is
+// only safe when each invocation touches nothing but its own texel.
+// double buffered, it reads the current state from binding 0 and writes
+// the next to binding 1, and swap() makes that the current state, so
+// stencils can read their neighbours without racing
+//
+// the kernel gets the storage format as defines, so one source works for
+// any of them:
+//
+//   layout(STATE_FORMAT, binding = 0) uniform STATE_IMAGE state;
+//   STATE_VEC value = imageLoad( state, STATE_COORD( gl_GlobalInvocationID ) );
+//
+// a size with depth above one makes the state a 3d texture, STATE_IMAGE
+// an image3D, STATE_COORD an ivec3 and STATE_DIMENSIONS 3, otherwise it's
+// 2. the grid is the size divided by the kernel's local size, rounded up,
+// so kernels with a local size above one should skip invocations past
+// state_size, a uvec3 uniform. a kernel for both should pick its local
+// size on STATE_DIMENSIONS, a local z above one on a 2d state only adds
+// invocations that all get skipped
+//
+// anything else the kernel needs, more images, storage or uniform blocks,
+// goes in its binding table with the attach functions. attachments are
+// checked against what the program declares and applied on every use()
 class Compute {
     public:
-    unsigned int id;
-    unsigned int out_tex;
+    ComputeProgram program;
+    // always the current state
+    TextureHandle out_tex;
+    // next state when double buffered, empty otherwise
+    TextureHandle back_tex;
+    // resizes that had to reallocate the storage
+    unsigned int reallocations;
 
-    Compute( const char* path, glm::uvec2 size ) {
+    Compute( const char* path, glm::uvec3 size, bool double_buffered = false, ComputeFormat format = ComputeFormat::R32F )
+        : program( path, state_defines( compute_format_info( format ), size.z > 1 ) ),
+          step_params( "compute step params", 0 ) {
         work_size = size;
+        capacity = size;
+        reallocations = 0;
+        target = size.z > 1 ? GL_TEXTURE_3D : GL_TEXTURE_2D;
+        this->format = compute_format_info( format );
 
-        // read in shader code
-        std::string compute_code;
-        std::ifstream file;
+        // looked up once, the program is never relinked
+        size_location = glGetUniformLocation( program.id.get(), "state_size" );
+        step_location = glGetUniformLocation( program.id.get(), "step" );
 
-        file.exceptions( std::ifstream::failbit | std::ifstream::badbit );
+        out_tex = make_state_texture( std::string( "compute " ) + path );
+        if ( double_buffered ) {
+            back_tex = make_state_texture( std::string( "compute " ) + path + " back" );
+        }
+        bind_images();
 
-        try {
-            file.open( path );
-            std::stringstream file_stream;
-            file_stream << file.rdbuf();
-            file.close();
+        declared = reflect_bindings( program.id.get() );
+    }
 
-            compute_code = file_stream.str();
-        } catch ( std::ifstream::failure e ) {
-            std::cerr << "failed to read compute shader file" << std::endl;
+    Compute( const char* path, glm::uvec2 size, bool double_buffered = false, ComputeFormat format = ComputeFormat::R32F )
+        : Compute( path, glm::uvec3( size, 1 ), double_buffered, format ) {
+    }
+
+    void use() {
+        program.use();
+        gl_state().active_texture( 0 );
+        gl_state().bind_texture( target, out_tex.get() );
+        if ( size_location >= 0 ) {
+            glUniform3ui( size_location, work_size.x, work_size.y, work_size.z );
         }
 
-        const char* c_shader_code = compute_code.c_str();
+        // other kernels share the binding points, so put ours back
+        bind_images();
+        for ( auto& a : attached ) {
+            switch ( a.kind ) {
+                case BindingKind::IMAGE:
+                    glBindImageTexture( a.binding, a.id, 0, GL_TRUE, 0, a.access, a.format );
+                    break;
+                case BindingKind::STORAGE:
+                    gl_state().bind_buffer_base( GL_SHADER_STORAGE_BUFFER, a.binding, a.id );
+                    break;
+                case BindingKind::UNIFORM:
+                    gl_state().bind_buffer_base( GL_UNIFORM_BUFFER, a.binding, a.id );
+                    break;
+            }
+        }
+    }
 
-        // compile shader
-        unsigned int shader;
+    // utility uniform functions, call use() first
+    void set_uint( const char* name, unsigned int value ) {
+        program.set_uint( name, value );
+    }
 
-        shader = glCreateShader( GL_COMPUTE_SHADER );
-        glShaderSource( shader, 1, &c_shader_code, NULL );
-        glCompileShader( shader );
+    void set_float( const char* name, float value ) {
+        program.set_float( name, value );
+    }
 
-        // create program
-        id = glCreateProgram();
-        glAttachShader( id, shader );
-        glLinkProgram( id );
+    // attach another texture as an image, e.g. another Compute's out_tex.
+    // format is its internal format, access GL_READ_ONLY and so on.
+    // returns false and attaches nothing if the kernel has no such image,
+    // or if the texture doesn't fit what the kernel declared there
+    bool attach_image( unsigned int binding, unsigned int texture, GLenum format, GLenum access = GL_READ_ONLY ) {
+        if ( binding < ( back_tex ? 2u : 1u ) ) {
+            std::cerr << "compute: image binding " << binding << " holds the compute state" << std::endl;
+            return false;
+        }
 
-        // cleanup
-        glDeleteShader( shader );
+        int image = find( declared, BindingKind::IMAGE, binding );
+        if ( image >= 0 && !check_image( declared[ image ], texture, format ) ) {
+            return false;
+        }
+        return attach( { BindingKind::IMAGE, binding, texture, access, format } );
+    }
 
-        // create input/output textures
-        glGenTextures( 1, &out_tex );
-        glActiveTexture( GL_TEXTURE0 );
-        glBindTexture( GL_TEXTURE_2D, out_tex );
+    // the buffer's id is taken now, attach again if it gets reallocated
+    bool attach_storage( unsigned int binding, StorageBuffer& buffer ) {
+        if ( binding == STEP_PARAMS_BINDING ) {
+            std::cerr << "compute: storage binding " << binding << " holds the step parameters" << std::endl;
+            return false;
+        }
+        return attach( { BindingKind::STORAGE, binding, buffer.id.get(), GL_NONE, GL_NONE } );
+    }
 
-        // turns out we need this. huh.
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    bool attach_uniform( unsigned int binding, StorageBuffer& buffer ) {
+        return attach( { BindingKind::UNIFORM, binding, buffer.id.get(), GL_NONE, GL_NONE } );
+    }
 
-        // create empty texture
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_R32F, size.x, size.y, 0, GL_RED, GL_FLOAT, NULL );
-        glBindImageTexture( 0, out_tex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F );
+    void detach_all() {
+        attached.clear();
     }
 
-    ~Compute() {
-        glDeleteProgram( id );
+    // reports everything the kernel declares that has nothing attached,
+    // false if there's any
+    bool check_bindings() {
+        bool ok = true;
+        for ( auto& d : declared ) {
+            bool state = ( d.kind == BindingKind::IMAGE && d.binding < ( back_tex ? 2u : 1u ) )
+                || ( d.kind == BindingKind::STORAGE && d.binding == STEP_PARAMS_BINDING );
+            if ( state || find( attached, d.kind, d.binding ) >= 0 ) {
+                continue;
+            }
+
+            std::cerr << "compute: " << binding_kind_name( d.kind ) << " " << d.name << " at binding "
+                << d.binding << " has nothing attached" << std::endl;
+            ok = false;
+        }
+        return ok;
     }
 
-    void use() {
-        glUseProgram( id );
-        glActiveTexture( GL_TEXTURE0 );
-        glBindTexture( GL_TEXTURE_2D, out_tex );
+    // after each dispatch when double buffered, a no-op otherwise
+    void swap() {
+        if ( !back_tex ) {
+            return;
+        }
+
+        std::swap( out_tex, back_tex );
+        bind_images();
+        gl_state().active_texture( 0 );
+        gl_state().bind_texture( target, out_tex.get() );
+    }
+
+    // run steps dispatches back to back, swapping and putting an image
+    // barrier between each. call wait() before reading the result
+    void step( unsigned int steps ) {
+        use();
+        for ( unsigned int i = 0; i < steps; i++ ) {
+            if ( i > 0 ) {
+                glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+            }
+            dispatch();
+            swap();
+        }
+    }
+
+    // like step(), but every step gets its own parameters. they're uploaded
+    // in one go and bound once, then each dispatch only changes the step
+    // uniform, so nothing between steps but the image barrier
+    void submit_steps( const StepParams* params, unsigned int steps ) {
+        if ( steps == 0 ) {
+            return;
+        }
+
+        size_t bytes = steps * sizeof(StepParams);
+        if ( step_params.size < bytes ) {
+            step_params = StorageBuffer( "compute step params", std::max( bytes, (size_t) 64 * sizeof(StepParams) ) );
+        }
+        step_params.upload( params, bytes );
+        step_params.bind_base( STEP_PARAMS_BINDING );
+
+        use();
+        for ( unsigned int i = 0; i < steps; i++ ) {
+            if ( i > 0 ) {
+                glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+            }
+            if ( step_location >= 0 ) {
+                glUniform1ui( step_location, i );
+            }
+            dispatch();
+            swap();
+        }
     }
 
     void dispatch() {
-        // just keep it simple, 2d work group
-        glDispatchCompute( work_size.x, work_size.y, 1 );
+        glDispatchCompute( groups( 0 ), groups( 1 ), groups( 2 ) );
+    }
+
+    // like dispatch(), but the group counts come from args on the gpu,
+    // see ComputeProgram::dispatch_indirect
+    void dispatch_indirect( StorageBuffer& args, size_t offset = 0 ) {
+        program.dispatch_indirect( args, offset );
     }
 
-    void wait() {
-        glMemoryBarrier( GL_ALL_BARRIER_BITS );
+    // defaults to a full barrier, pass narrower bits when only the next
+    // dispatch needs to see the writes
+    void wait( GLbitfield barriers = GL_ALL_BARRIER_BITS ) {
+        glMemoryBarrier( barriers );
     }
 
-    void set_values( float* values ) {
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_R32F, work_size.x, work_size.y, 0, GL_RED, GL_FLOAT, values );
+    // overwrites the existing storage rather than reallocating it. count()
+    // * channels() values, channels interleaved. T has to match the format
+    template <typename T>
+    void set_values( const T* values ) {
+        if ( !check_type<T>( "set_values" ) ) {
+            return;
+        }
+        if ( target == GL_TEXTURE_3D ) {
+            glTexSubImage3D( target, 0, 0, 0, 0, work_size.x, work_size.y, work_size.z, format.pixel_format, format.type, values );
+        } else {
+            glTexSubImage2D( target, 0, 0, 0, work_size.x, work_size.y, format.pixel_format, format.type, values );
+        }
     }
 
-    std::vector<float> get_values() {
-        unsigned int collection_size = work_size.x * work_size.y;
-        std::vector<float> compute_data( collection_size );
-        glGetTexImage( GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, compute_data.data() );
+    // copy the values into a storage buffer without going through the cpu,
+    // e.g. to reduce them. call wait() after the dispatch first
+    void copy_to( StorageBuffer& buffer ) {
+        use();
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, buffer.id.get() );
+        read_pixels( NULL );
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+    }
+
+    // texels, not values, see channels()
+    unsigned int count() {
+        return work_size.x * work_size.y * work_size.z;
+    }
+
+    unsigned int channels() {
+        return format.channels;
+    }
+
+    // bytes of gpu storage per texel
+    size_t texel_bytes() {
+        return GpuMemory::texel_bytes( format.internal_format );
+    }
+
+    // count() * channels() values, channels interleaved. T has to match
+    // the format
+    template <typename T = float>
+    std::vector<T> get_values() {
+        if ( !check_type<T>( "get_values" ) ) {
+            return std::vector<T>();
+        }
+
+        std::vector<T> compute_data( count() * channels() );
+        read_pixels( compute_data.data() );
 
         return compute_data;
     }
 
+    // same, but into memory the caller owns, e.g. a mapped output file
+    template <typename T>
+    void get_values( T* destination ) {
+        if ( check_type<T>( "get_values" ) ) {
+            read_pixels( destination );
+        }
+    }
+
+    // double buffered, the state one step before the current one: the last
+    // step read it and swap() left it in back_tex. empty when single
+    // buffered, that state was overwritten in place
+    template <typename T = float>
+    std::vector<T> get_previous_values() {
+        if ( !back_tex || !check_type<T>( "get_previous_values" ) ) {
+            return std::vector<T>();
+        }
+
+        std::vector<T> compute_data( count() * channels() );
+        read_pixels( compute_data.data(), back_tex.get() );
+
+        return compute_data;
+    }
+
+    // change the size without rebuilding the program. storage only gets
+    // reallocated when the new size doesn't fit, and then grows by half
+    // again on the axes that overflowed, so sizes that wander up and down
+    // settle without reallocating. values are undefined afterwards, set
+    // them again. a 2d Compute can't become a volume or back, the kernel
+    // was built for one of them
+    bool resize( glm::uvec3 size ) {
+        if ( ( size.z > 1 ) != ( target == GL_TEXTURE_3D ) ) {
+            std::cerr << "compute: can't resize between 2d and 3d" << std::endl;
+            return false;
+        }
+
+        work_size = size;
+        if ( glm::all( glm::lessThanEqual( size, capacity ) ) ) {
+            return true;
+        }
+
+        for ( int axis = 0; axis < 3; axis++ ) {
+            if ( size[ axis ] > capacity[ axis ] ) {
+                capacity[ axis ] = std::max( size[ axis ], capacity[ axis ] + capacity[ axis ] / 2 );
+            }
+        }
+
+        allocate( out_tex );
+        if ( back_tex ) {
+            allocate( back_tex );
+        }
+        bind_images();
+        reallocations++;
+
+        return true;
+    }
+
+    bool resize( glm::uvec2 size ) {
+        return resize( glm::uvec3( size, 1 ) );
+    }
+
+    // texels the storage can hold before a resize has to reallocate
+    glm::uvec3 storage_size() {
+        return capacity;
+    }
+
 private:
-    glm::uvec2 work_size;
+    static const unsigned int STEP_PARAMS_BINDING = 7;
+
+    struct Attachment {
+        BindingKind kind;
+        unsigned int binding;
+        unsigned int id;
+        // images only
+        GLenum access;
+        GLenum format;
+    };
+
+    std::vector<ProgramBinding> declared;
+    std::vector<Attachment> attached;
+
+    glm::uvec3 work_size;
+    // allocated size, at least work_size on every axis
+    glm::uvec3 capacity;
+    // only made once a readback needs a region smaller than the storage
+    FramebufferHandle read_framebuffer;
+    // GL_TEXTURE_3D for volumes, GL_TEXTURE_2D otherwise
+    GLenum target;
+    int size_location;
+    // -1 when the kernel has no step uniform
+    int step_location;
+    ComputeFormatInfo format;
+    // empty until the first batch, grown as needed
+    StorageBuffer step_params;
+
+    static std::string state_defines( const ComputeFormatInfo& format, bool volume ) {
+        return std::string( "#define STATE_FORMAT " ) + format.glsl_format + "\n"
+            + "#define STATE_IMAGE " + format.glsl_image + ( volume ? "3D" : "2D" ) + "\n"
+            + "#define STATE_VEC " + format.glsl_vec + "\n"
+            + "#define STATE_COORD " + ( volume ? "ivec3" : "ivec2" ) + "\n"
+            + "#define STATE_DIMENSIONS " + ( volume ? "3" : "2" ) + "\n";
+    }
+
+    TextureHandle make_state_texture( const std::string& label ) {
+        TextureHandle texture = make_texture( label );
+        gl_state().active_texture( 0 );
+        gl_state().bind_texture( target, texture.get() );
+
+        // turns out we need this. huh.
+        glTexParameteri( target, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glTexParameteri( target, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+
+        allocate( texture );
+        return texture;
+    }
+
+    // (re)create empty storage of the current capacity
+    void allocate( TextureHandle& texture ) {
+        gl_state().active_texture( 0 );
+        if ( target == GL_TEXTURE_3D ) {
+            gpu_memory().tex_image_3d( texture.get(), format.internal_format, capacity.x, capacity.y, capacity.z,
+                format.pixel_format, format.type, NULL );
+        } else {
+            gpu_memory().tex_image_2d( texture.get(), format.internal_format, capacity.x, capacity.y,
+                format.pixel_format, format.type, NULL );
+        }
+        // leave the current state bound for set/get
+        gl_state().bind_texture( target, out_tex.get() );
+    }
+
+    // read the work_size corner of the current state, or of texture, into
+    // pixels or into the bound pack buffer at that offset. a storage bigger
+    // than the work size is read a slice at a time through a framebuffer
+    void read_pixels( void* pixels, unsigned int texture = 0 ) {
+        if ( texture == 0 ) {
+            texture = out_tex.get();
+        }
+
+        if ( work_size == capacity ) {
+            gl_state().active_texture( 0 );
+            gl_state().bind_texture( target, texture );
+            glGetTexImage( target, 0, format.pixel_format, format.type, pixels );
+            gl_state().bind_texture( target, out_tex.get() );
+            return;
+        }
+
+        if ( !read_framebuffer ) {
+            read_framebuffer = make_framebuffer();
+        }
+        gl_state().bind_framebuffer( GL_READ_FRAMEBUFFER, read_framebuffer.get() );
+
+        // every client type we use is 4 bytes a channel
+        size_t slice_bytes = (size_t) work_size.x * work_size.y * format.channels * 4;
+        for ( unsigned int z = 0; z < work_size.z; z++ ) {
+            if ( target == GL_TEXTURE_3D ) {
+                glFramebufferTextureLayer( GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0, z );
+            } else {
+                glFramebufferTexture2D( GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0 );
+            }
+            glReadPixels( 0, 0, work_size.x, work_size.y, format.pixel_format, format.type,
+                (char*) pixels + z * slice_bytes );
+        }
+
+        gl_state().bind_framebuffer( GL_READ_FRAMEBUFFER, 0 );
+    }
+
+    // layered, so a volume binds all of its slices. 2d textures ignore it
+    void bind_images() {
+        if ( back_tex ) {
+            glBindImageTexture( 0, out_tex.get(), 0, GL_TRUE, 0, GL_READ_ONLY, format.internal_format );
+            glBindImageTexture( 1, back_tex.get(), 0, GL_TRUE, 0, GL_WRITE_ONLY, format.internal_format );
+        } else {
+            glBindImageTexture( 0, out_tex.get(), 0, GL_TRUE, 0, GL_READ_WRITE, format.internal_format );
+        }
+    }
+
+    // work groups along one axis, enough to cover the size
+    unsigned int groups( int axis ) {
+        return ( work_size[ axis ] + program.local_size[ axis ] - 1 ) / program.local_size[ axis ];
+    }
+
+    static const char* binding_kind_name( BindingKind kind ) {
+        switch ( kind ) {
+            case BindingKind::IMAGE: return "image";
+            case BindingKind::STORAGE: return "storage block";
+            case BindingKind::UNIFORM: return "uniform block";
+        }
+        return "resource";
+    }
+
+    template <typename Binding>
+    static int find( const std::vector<Binding>& bindings, BindingKind kind, unsigned int binding ) {
+        for ( size_t i = 0; i < bindings.size(); i++ ) {
+            if ( bindings[ i ].kind == kind && bindings[ i ].binding == binding ) {
+                return (int) i;
+            }
+        }
+        return -1;
+    }
+
+    static const char* target_name( GLenum target ) {
+        switch ( target ) {
+            case GL_TEXTURE_2D: return "2d texture";
+            case GL_TEXTURE_3D: return "3d texture";
+            case GL_TEXTURE_2D_ARRAY: return "2d array texture";
+            case GL_TEXTURE_BUFFER: return "buffer texture";
+        }
+        return "texture";
+    }
+
+    static const char* element_type_name( GLenum type ) {
+        switch ( type ) {
+            case GL_INT: return "int";
+            case GL_UNSIGNED_INT: return "uint";
+        }
+        return "float";
+    }
+
+    // the element type image loads and stores of an internal format give
+    static GLenum format_element_type( GLenum internal_format ) {
+        switch ( internal_format ) {
+            case GL_R32I: case GL_RGBA32I: return GL_INT;
+            case GL_R32UI: case GL_RGBA32UI: return GL_UNSIGNED_INT;
+        }
+        return GL_FLOAT;
+    }
+
+    // the texture has to be allocated as format, with the target and
+    // element type of the declared image. gl 4.3 can't reflect the image's
+    // format qualifier, so a kernel declaring r32f with an rg32f texture
+    // attached gets past this, anything else mismatched is caught here
+    // instead of as undefined behaviour on the gpu
+    bool check_image( const ProgramBinding& image, unsigned int texture, GLenum format ) {
+        GLenum texture_target, texture_format;
+        if ( !gpu_memory().texture_format( texture, texture_target, texture_format ) ) {
+            std::cerr << "compute: texture " << texture << " for image " << image.name
+                << " was not allocated through gpu_memory(), can't check it" << std::endl;
+            return false;
+        }
+
+        const char* problem = NULL;
+        if ( texture_format != format ) {
+            problem = "the texture's format isn't the one given";
+        } else if ( texture_target != image_target( image.type ) ) {
+            problem = "the texture's target doesn't match the image's dimensions";
+        } else if ( format_element_type( format ) != image_element_type( image.type ) ) {
+            problem = "the format's element type doesn't match the image's";
+        }
+
+        if ( problem != NULL ) {
+            std::cerr << "compute: can't attach to image " << image.name << " at binding " << image.binding << ", "
+                << problem << ": kernel declares a " << element_type_name( image_element_type( image.type ) )
+                << " image of a " << target_name( image_target( image.type ) ) << ", given " << gpu_memory().format_name( format )
+                << ", texture is a " << gpu_memory().format_name( texture_format ) << " "
+                << target_name( texture_target ) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // replaces whatever was attached at the same binding before
+    bool attach( const Attachment& attachment ) {
+        if ( find( declared, attachment.kind, attachment.binding ) < 0 ) {
+            std::cerr << "compute: kernel has no " << binding_kind_name( attachment.kind ) << " at binding "
+                << attachment.binding << std::endl;
+            return false;
+        }
+
+        int existing = find( attached, attachment.kind, attachment.binding );
+        if ( existing >= 0 ) {
+            attached[ existing ] = attachment;
+        } else {
+            attached.push_back( attachment );
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool check_type( const char* what ) {
+        if ( client_type<T>() != format.type ) {
+            std::cerr << "compute: " << what << " element type does not match the " << format.glsl_format
+                << " storage format" << std::endl;
+            return false;
+        }
+        return true;
+    }
 };
 
 #endif
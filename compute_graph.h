@@ -0,0 +1,404 @@
+#ifndef COMPUTE_GRAPH_H
+#define COMPUTE_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "storage_buffer.h"
+
+// how a pass touches a resource, which decides the barrier bit a later
+// access needs after a shader wrote it
+enum class Access {
+    STORAGE,   // ssbo load/store
+    IMAGE,     // imageLoad/imageStore
+    TEXTURE,   // sampled
+    UNIFORM,   // ubo
+    INDIRECT,  // dispatch or draw indirect args
+    TRANSFER,  // copies, uploads and readbacks
+};
+
+// compute passes that declare what they read and write instead of
+// barriering by hand. on execute the graph culls passes nothing needs,
+// orders the rest so independent passes share a barrier, aliases transient
+// buffers whose lifetimes don't overlap onto the same memory, and only
+// issues the barrier bits the next accesses actually need
+//
+// rebuilt every frame: reset(), declare resources and passes, execute().
+// transient memory is kept between frames
+class ComputeGraph {
+public:
+    typedef int Resource;
+
+    class PassBuilder {
+    public:
+        PassBuilder( ComputeGraph& graph, size_t pass ) : graph( graph ), pass( pass ) {
+        }
+
+        PassBuilder& read( Resource resource, Access access ) {
+            graph.passes[ pass ].uses.push_back( { resource, access, false } );
+            return *this;
+        }
+
+        PassBuilder& write( Resource resource, Access access ) {
+            graph.passes[ pass ].uses.push_back( { resource, access, true } );
+            return *this;
+        }
+
+    private:
+        ComputeGraph& graph;
+        size_t pass;
+    };
+
+    ComputeGraph() {
+        executed = culled = barriers = 0;
+        transient_bytes = aliased_bytes = 0;
+    }
+
+    void reset() {
+        resources.clear();
+        passes.clear();
+        outputs.clear();
+        order.clear();
+    }
+
+    // a buffer owned outside the graph, it lives across frames
+    Resource import_buffer( const char* name, StorageBuffer& buffer ) {
+        resources.push_back( { name, &buffer, 0, 0, -1 } );
+        return (Resource) resources.size() - 1;
+    }
+
+    // a texture owned outside the graph, e.g. Compute::out_tex
+    Resource import_image( const char* name, unsigned int texture ) {
+        resources.push_back( { name, NULL, texture, 0, -1 } );
+        return (Resource) resources.size() - 1;
+    }
+
+    // a buffer only used within this frame's passes. the memory behind it
+    // may be shared with other transients, so it starts undefined
+    Resource create_buffer( const char* name, size_t bytes ) {
+        resources.push_back( { name, NULL, 0, bytes, -1 } );
+        return (Resource) resources.size() - 1;
+    }
+
+    // read after the graph runs, e.g. by a readback. passes only writing
+    // to anything else get culled
+    void output( Resource resource, Access access ) {
+        outputs.push_back( { resource, access, false } );
+    }
+
+    // the pass body binds whatever it needs, buffer() resolves resources
+    PassBuilder add_pass( const char* name, std::function<void()> run ) {
+        passes.push_back( { name, run, {}, false, 0, 0 } );
+        return PassBuilder( *this, passes.size() - 1 );
+    }
+
+    // only valid while the graph executes
+    StorageBuffer& buffer( Resource resource ) {
+        return *resources[ resource ].buffer;
+    }
+
+    void execute() {
+        cull();
+        schedule();
+        alias();
+        place_barriers();
+
+        for ( size_t p : order ) {
+            Pass& pass = passes[ p ];
+            if ( pass.barrier != 0 ) {
+                glMemoryBarrier( pass.barrier );
+                barriers++;
+            }
+            pass.run();
+            executed++;
+        }
+
+        if ( final_barrier != 0 ) {
+            glMemoryBarrier( final_barrier );
+            barriers++;
+        }
+    }
+
+    void print_summary( std::ostream& out ) {
+        out << "compute graph: " << executed << " passes run, " << culled << " culled, "
+            << barriers << " barriers";
+        if ( transient_bytes > 0 ) {
+            out << ", transient peak " << aliased_bytes / 1024 << "KiB aliased from "
+                << transient_bytes / 1024 << "KiB";
+        }
+        out << std::endl;
+    }
+
+private:
+    struct Use {
+        Resource resource;
+        Access access;
+        bool write;
+    };
+
+    struct ResourceInfo {
+        const char* name;
+        // imported or, once aliased, the transient's physical buffer
+        StorageBuffer* buffer;
+        unsigned int texture;
+        // transients only
+        size_t bytes;
+        int physical;
+    };
+
+    struct Pass {
+        const char* name;
+        std::function<void()> run;
+        std::vector<Use> uses;
+        bool culled;
+        // scheduling wave, passes in one wave need no barrier between them
+        int wave;
+        GLbitfield barrier;
+    };
+
+    // transient memory, grown but never shrunk between frames
+    struct Physical {
+        StorageBuffer buffer;
+        // position in the order of the last pass using it this frame
+        int busy_until;
+    };
+
+    std::vector<ResourceInfo> resources;
+    std::vector<Pass> passes;
+    std::vector<Use> outputs;
+    std::vector<size_t> order;
+    std::vector<Physical> physical;
+    GLbitfield final_barrier;
+
+    unsigned long long executed, culled, barriers;
+    size_t transient_bytes, aliased_bytes;
+
+    static GLbitfield barrier_bit( Access access ) {
+        switch ( access ) {
+            case Access::STORAGE: return GL_SHADER_STORAGE_BARRIER_BIT;
+            case Access::IMAGE: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+            case Access::TEXTURE: return GL_TEXTURE_FETCH_BARRIER_BIT;
+            case Access::UNIFORM: return GL_UNIFORM_BARRIER_BIT;
+            case Access::INDIRECT: return GL_COMMAND_BARRIER_BIT;
+            case Access::TRANSFER:
+                return GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT;
+        }
+        return GL_ALL_BARRIER_BITS;
+    }
+
+    static std::string transient_label( size_t index ) {
+        return "compute graph transient " + std::to_string( index );
+    }
+
+    // only shader writes are incoherent, gl orders everything else itself
+    static bool shader_write( const Use& use ) {
+        return use.write && ( use.access == Access::STORAGE || use.access == Access::IMAGE );
+    }
+
+    // walk backwards from the outputs, a pass survives if something live
+    // reads what it writes. a pass that overwrites a resource without
+    // reading it ends the liveness of earlier writes
+    void cull() {
+        std::vector<bool> live( resources.size(), false );
+        for ( auto& use : outputs ) {
+            live[ use.resource ] = true;
+        }
+
+        for ( size_t p = passes.size(); p-- > 0; ) {
+            Pass& pass = passes[ p ];
+            bool needed = false;
+            for ( auto& use : pass.uses ) {
+                needed = needed || ( use.write && live[ use.resource ] );
+            }
+
+            pass.culled = !needed;
+            if ( !needed ) {
+                culled++;
+                continue;
+            }
+
+            for ( auto& use : pass.uses ) {
+                if ( use.write ) {
+                    live[ use.resource ] = false;
+                }
+            }
+            for ( auto& use : pass.uses ) {
+                if ( !use.write ) {
+                    live[ use.resource ] = true;
+                }
+            }
+        }
+    }
+
+    // a pass goes in the first wave after everything it depends on. a
+    // dependency on a shader write needs a barrier, so the next wave; any
+    // other conflict only needs submission order, so the same wave can do.
+    // passes are stable sorted by wave, one barrier then covers a wave
+    void schedule() {
+        for ( size_t p = 0; p < passes.size(); p++ ) {
+            Pass& pass = passes[ p ];
+            pass.wave = 0;
+            if ( pass.culled ) {
+                continue;
+            }
+
+            for ( size_t q = 0; q < p; q++ ) {
+                Pass& earlier = passes[ q ];
+                if ( earlier.culled ) {
+                    continue;
+                }
+
+                for ( auto& a : earlier.uses ) {
+                    for ( auto& b : pass.uses ) {
+                        if ( a.resource != b.resource || ( !a.write && !b.write ) ) {
+                            continue;
+                        }
+                        pass.wave = std::max( pass.wave, earlier.wave + ( shader_write( a ) ? 1 : 0 ) );
+                    }
+                }
+            }
+        }
+
+        order.clear();
+        for ( size_t p = 0; p < passes.size(); p++ ) {
+            if ( !passes[ p ].culled ) {
+                order.push_back( p );
+            }
+        }
+        std::stable_sort( order.begin(), order.end(), [ this ]( size_t a, size_t b ) {
+            return passes[ a ].wave < passes[ b ].wave;
+        } );
+    }
+
+    // first fit of each transient, in order of first use, into physical
+    // buffers free by then. too small a free buffer is grown rather than
+    // adding another
+    void alias() {
+        std::vector<int> first( resources.size(), -1 ), last( resources.size(), -1 );
+        for ( size_t i = 0; i < order.size(); i++ ) {
+            for ( auto& use : passes[ order[ i ] ].uses ) {
+                if ( first[ use.resource ] < 0 ) {
+                    first[ use.resource ] = (int) i;
+                }
+                last[ use.resource ] = (int) i;
+            }
+        }
+
+        for ( auto& p : physical ) {
+            p.busy_until = -1;
+        }
+
+        std::vector<Resource> transients;
+        for ( size_t r = 0; r < resources.size(); r++ ) {
+            if ( resources[ r ].buffer == NULL && resources[ r ].texture == 0 && first[ r ] >= 0 ) {
+                transients.push_back( (Resource) r );
+            }
+        }
+        std::stable_sort( transients.begin(), transients.end(), [ & ]( Resource a, Resource b ) {
+            return first[ a ] < first[ b ];
+        } );
+
+        size_t requested = 0;
+        for ( Resource r : transients ) {
+            ResourceInfo& resource = resources[ r ];
+            requested += resource.bytes;
+
+            int chosen = -1;
+            for ( size_t i = 0; i < physical.size(); i++ ) {
+                if ( physical[ i ].busy_until >= first[ r ] ) {
+                    continue;
+                }
+                // prefer the smallest that fits, else the biggest to grow
+                if ( chosen < 0 ) {
+                    chosen = (int) i;
+                    continue;
+                }
+                size_t size = physical[ i ].buffer.size, best = physical[ chosen ].buffer.size;
+                bool fits = size >= resource.bytes, best_fits = best >= resource.bytes;
+                if ( ( fits && ( !best_fits || size < best ) ) || ( !fits && !best_fits && size > best ) ) {
+                    chosen = (int) i;
+                }
+            }
+
+            if ( chosen < 0 ) {
+                physical.push_back( { StorageBuffer( transient_label( physical.size() ), resource.bytes ), -1 } );
+                chosen = (int) physical.size() - 1;
+            } else if ( physical[ chosen ].buffer.size < resource.bytes ) {
+                physical[ chosen ].buffer = StorageBuffer( transient_label( chosen ), resource.bytes );
+            }
+
+            physical[ chosen ].busy_until = last[ r ];
+            resource.physical = chosen;
+        }
+
+        // pointers only once the vector has stopped growing
+        for ( Resource r : transients ) {
+            resources[ r ].buffer = &physical[ resources[ r ].physical ].buffer;
+        }
+
+        size_t total = 0;
+        for ( auto& p : physical ) {
+            total += p.buffer.size;
+        }
+        transient_bytes = std::max( transient_bytes, requested );
+        aliased_bytes = std::max( aliased_bytes, total );
+    }
+
+    // replay the order tracking, per piece of memory, the position of its
+    // last unbarriered shader write, and per barrier bit, the position it
+    // was last issued at. an access needs a bit when the write came after
+    // that bit's last barrier
+    void place_barriers() {
+        std::vector<int> last_write( resources.size() + physical.size(), -1 );
+        std::vector<int> last_barrier( 32, -1 );
+
+        auto memory = [ & ]( Resource r ) {
+            int p = resources[ r ].physical;
+            return p >= 0 ? resources.size() + p : (size_t) r;
+        };
+        auto needed = [ & ]( const Use& use, int position ) {
+            GLbitfield bits = barrier_bit( use.access ), missing = 0;
+            int written = last_write[ memory( use.resource ) ];
+            for ( int bit = 0; bit < 32 && written >= 0; bit++ ) {
+                if ( ( bits & ( 1u << bit ) ) && last_barrier[ bit ] <= written && written < position ) {
+                    missing |= 1u << bit;
+                }
+            }
+            return missing;
+        };
+        auto issue = [ & ]( GLbitfield bits, int position ) {
+            for ( int bit = 0; bit < 32; bit++ ) {
+                if ( bits & ( 1u << bit ) ) {
+                    last_barrier[ bit ] = position;
+                }
+            }
+        };
+
+        for ( size_t i = 0; i < order.size(); i++ ) {
+            Pass& pass = passes[ order[ i ] ];
+            pass.barrier = 0;
+            for ( auto& use : pass.uses ) {
+                pass.barrier |= needed( use, (int) i );
+            }
+            issue( pass.barrier, (int) i );
+
+            for ( auto& use : pass.uses ) {
+                if ( shader_write( use ) ) {
+                    last_write[ memory( use.resource ) ] = (int) i;
+                }
+            }
+        }
+
+        final_barrier = 0;
+        for ( auto& use : outputs ) {
+            final_barrier |= needed( use, (int) order.size() );
+        }
+    }
+};
+
+#endif
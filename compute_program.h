@@ -0,0 +1,227 @@
+#ifndef COMPUTE_PROGRAM_H
+#define COMPUTE_PROGRAM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "storage_buffer.h"
+
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// reads and builds a compute shader. defines (lines like "#define X 1\n")
+// go straight after the #version line so kernels can be specialised
+ProgramHandle load_compute_program( const char* path, const std::string& defines = "" ) {
+    // read in shader code
+    std::string compute_code;
+    std::ifstream file;
+
+    file.exceptions( std::ifstream::failbit | std::ifstream::badbit );
+
+    try {
+        file.open( path );
+        std::stringstream file_stream;
+        file_stream << file.rdbuf();
+        file.close();
+
+        compute_code = file_stream.str();
+    } catch ( std::ifstream::failure& e ) {
+        std::cerr << "failed to read compute shader file " << path << std::endl;
+    }
+
+    if ( !defines.empty() ) {
+        size_t version_end = compute_code.find( '\n', compute_code.find( "#version" ) );
+        size_t insert_at = version_end == std::string::npos ? 0 : version_end + 1;
+        compute_code.insert( insert_at, defines );
+    }
+
+    const char* c_shader_code = compute_code.c_str();
+
+    // compile shader
+    unsigned int shader;
+
+    shader = glCreateShader( GL_COMPUTE_SHADER );
+    glShaderSource( shader, 1, &c_shader_code, NULL );
+    glCompileShader( shader );
+
+    int success;
+    char info_log[ 1024 ];
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &success );
+    if ( !success ) {
+        glGetShaderInfoLog( shader, sizeof(info_log), NULL, info_log );
+        std::cerr << "failed to compile compute shader " << path << "\n" << info_log << std::endl;
+    }
+
+    // create program
+    ProgramHandle program( glCreateProgram() );
+    glAttachShader( program.get(), shader );
+    glLinkProgram( program.get() );
+
+    glGetProgramiv( program.get(), GL_LINK_STATUS, &success );
+    if ( !success ) {
+        glGetProgramInfoLog( program.get(), sizeof(info_log), NULL, info_log );
+        std::cerr << "failed to link compute shader " << path << "\n" << info_log << std::endl;
+    }
+
+    // cleanup
+    glDeleteShader( shader );
+
+    return program;
+}
+
+enum class BindingKind {
+    IMAGE,
+    STORAGE,
+    UNIFORM,
+};
+
+// a resource binding the linked program actually uses
+struct ProgramBinding {
+    BindingKind kind;
+    unsigned int binding;
+    std::string name;
+    // images only, the uniform type, e.g. GL_IMAGE_2D or GL_UNSIGNED_INT_IMAGE_3D
+    GLenum type;
+};
+
+// the texture target an image uniform type binds
+GLenum image_target( GLenum type ) {
+    switch ( type ) {
+        case GL_IMAGE_2D: case GL_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_2D: return GL_TEXTURE_2D;
+        case GL_IMAGE_3D: case GL_INT_IMAGE_3D: case GL_UNSIGNED_INT_IMAGE_3D: return GL_TEXTURE_3D;
+        case GL_IMAGE_2D_ARRAY: case GL_INT_IMAGE_2D_ARRAY: case GL_UNSIGNED_INT_IMAGE_2D_ARRAY: return GL_TEXTURE_2D_ARRAY;
+        case GL_IMAGE_BUFFER: case GL_INT_IMAGE_BUFFER: case GL_UNSIGNED_INT_IMAGE_BUFFER: return GL_TEXTURE_BUFFER;
+        default: return GL_NONE;
+    }
+}
+
+// the element type an image uniform type loads and stores, GL_FLOAT,
+// GL_INT or GL_UNSIGNED_INT
+GLenum image_element_type( GLenum type ) {
+    switch ( type ) {
+        case GL_INT_IMAGE_2D: case GL_INT_IMAGE_3D: case GL_INT_IMAGE_2D_ARRAY: case GL_INT_IMAGE_BUFFER:
+            return GL_INT;
+        case GL_UNSIGNED_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_3D: case GL_UNSIGNED_INT_IMAGE_2D_ARRAY:
+        case GL_UNSIGNED_INT_IMAGE_BUFFER:
+            return GL_UNSIGNED_INT;
+        default:
+            return GL_FLOAT;
+    }
+}
+
+// images, storage blocks and uniform blocks the program declares and the
+// compiler kept, with the bindings they ended up at
+std::vector<ProgramBinding> reflect_bindings( unsigned int program ) {
+    std::vector<ProgramBinding> bindings;
+    char name[ 256 ];
+    GLint count = 0;
+
+    const GLenum block_interfaces[ 2 ] = { GL_SHADER_STORAGE_BLOCK, GL_UNIFORM_BLOCK };
+    for ( GLenum interface : block_interfaces ) {
+        glGetProgramInterfaceiv( program, interface, GL_ACTIVE_RESOURCES, &count );
+        for ( GLint i = 0; i < count; i++ ) {
+            GLenum property = GL_BUFFER_BINDING;
+            GLint binding = 0;
+            glGetProgramResourceiv( program, interface, i, 1, &property, 1, NULL, &binding );
+            glGetProgramResourceName( program, interface, i, sizeof(name), NULL, name );
+
+            BindingKind kind = interface == GL_SHADER_STORAGE_BLOCK ? BindingKind::STORAGE : BindingKind::UNIFORM;
+            bindings.push_back( { kind, (unsigned int) binding, name, GL_NONE } );
+        }
+    }
+
+    // images are plain uniforms, their binding is the uniform's value
+    glGetProgramInterfaceiv( program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count );
+    for ( GLint i = 0; i < count; i++ ) {
+        const GLenum properties[ 2 ] = { GL_TYPE, GL_LOCATION };
+        GLint values[ 2 ] = { 0, -1 };
+        glGetProgramResourceiv( program, GL_UNIFORM, i, 2, properties, 2, NULL, values );
+
+        switch ( values[ 0 ] ) {
+            case GL_IMAGE_2D: case GL_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_2D:
+            case GL_IMAGE_3D: case GL_INT_IMAGE_3D: case GL_UNSIGNED_INT_IMAGE_3D:
+            case GL_IMAGE_2D_ARRAY: case GL_INT_IMAGE_2D_ARRAY: case GL_UNSIGNED_INT_IMAGE_2D_ARRAY:
+            case GL_IMAGE_BUFFER: case GL_INT_IMAGE_BUFFER: case GL_UNSIGNED_INT_IMAGE_BUFFER: {
+                GLint unit = 0;
+                glGetUniformiv( program, values[ 1 ], &unit );
+                glGetProgramResourceName( program, GL_UNIFORM, i, sizeof(name), NULL, name );
+                bindings.push_back( { BindingKind::IMAGE, (unsigned int) unit, name, (GLenum) values[ 0 ] } );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return bindings;
+}
+
+// a compute shader on its own, for kernels that manage their own buffers.
+// move only
+class ComputeProgram {
+public:
+    ProgramHandle id;
+    // the shader's local_size, read back from the linked program
+    glm::uvec3 local_size;
+
+    ComputeProgram( const char* path, const std::string& defines = "" ) {
+        id = load_compute_program( path, defines );
+
+        int size[ 3 ] = { 1, 1, 1 };
+        glGetProgramiv( id.get(), GL_COMPUTE_WORK_GROUP_SIZE, size );
+        local_size = glm::uvec3( size[ 0 ], size[ 1 ], size[ 2 ] );
+    }
+
+    void use() {
+        gl_state().use_program( id.get() );
+    }
+
+    // counts are work groups, not invocations
+    void dispatch( unsigned int x, unsigned int y = 1, unsigned int z = 1 ) {
+        glDispatchCompute( x, y, z );
+    }
+
+    // 1d dispatch of any number of groups. past the x limit the groups are
+    // spread over y too, so the shader should index with
+    // gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x and skip
+    // anything past the real group count
+    void dispatch_groups( size_t groups ) {
+        static int max_x = 0;
+        if ( max_x == 0 ) {
+            glGetIntegeri_v( GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &max_x );
+        }
+
+        size_t x = std::min( groups, (size_t) max_x );
+        size_t y = x == 0 ? 0 : ( groups + x - 1 ) / x;
+        glDispatchCompute( (unsigned int) x, (unsigned int) y, 1 );
+    }
+
+    // group counts read on the gpu from three uints at offset in args, e.g.
+    // CompactionArgs::dispatch written by an earlier kernel. the writer
+    // needs a GL_COMMAND_BARRIER_BIT barrier before this
+    void dispatch_indirect( StorageBuffer& args, size_t offset = 0 ) {
+        gl_state().bind_buffer( GL_DISPATCH_INDIRECT_BUFFER, args.id.get() );
+        glDispatchComputeIndirect( (GLintptr) offset );
+    }
+
+    // utility uniform functions, the program has to be in use
+    void set_uint( const char* name, unsigned int value ) {
+        glUniform1ui( glGetUniformLocation( id.get(), name ), value );
+    }
+
+    void set_int( const char* name, int value ) {
+        glUniform1i( glGetUniformLocation( id.get(), name ), value );
+    }
+
+    void set_float( const char* name, float value ) {
+        glUniform1f( glGetUniformLocation( id.get(), name ), value );
+    }
+};
+
+#endif
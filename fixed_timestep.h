@@ -0,0 +1,71 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <iostream>
+
+// decides how many fixed size simulation steps to run each frame, so the
+// simulation advances at the same rate no matter how fast we render
+class FixedTimestep {
+public:
+    // length of one step in seconds
+    double step;
+    // most steps run in a single frame before we give up and drop time
+    unsigned int max_steps;
+    // total steps run so far
+    unsigned long long step_count;
+
+    FixedTimestep( double rate, unsigned int max_steps ) {
+        step = 1.0 / rate;
+        this->max_steps = max_steps;
+        step_count = 0;
+        dropped_time = 0.0;
+
+        // start with one step owed so the first frame has something to show
+        accumulator = step;
+    }
+
+    // feed in how long the last frame took, returns how many steps to run now
+    unsigned int advance( double frame_seconds ) {
+        accumulator += frame_seconds;
+
+        unsigned int steps = (unsigned int) ( accumulator / step );
+
+        // if a frame took too long, don't try to catch up all at once or
+        // every frame after it gets longer too
+        if ( steps > max_steps ) {
+            dropped_time += ( steps - max_steps ) * step;
+            accumulator -= ( steps - max_steps ) * step;
+            steps = max_steps;
+        }
+
+        accumulator -= steps * step;
+        step_count += steps;
+
+        return steps;
+    }
+
+    // how far we are between the last step and the next one, 0-1. render
+    // previous and current state blended by this
+    float alpha() {
+        return (float) ( accumulator / step );
+    }
+
+    // simulation time matching alpha, one step behind the newest state
+    double interpolated_time() {
+        return ( (double) step_count - 1.0 + alpha() ) * step;
+    }
+
+    void print_summary( std::ostream& out ) {
+        out << "simulation steps: " << step_count << " at " << 1.0 / step << "hz";
+        if ( dropped_time > 0.0 ) {
+            out << " (fell behind and dropped " << dropped_time << "s)";
+        }
+        out << std::endl;
+    }
+
+private:
+    double accumulator;
+    double dropped_time;
+};
+
+#endif
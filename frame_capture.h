@@ -0,0 +1,297 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framebuffer.h"
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+// streams frames from a framebuffer to disk without stalling the render loop.
+// reads go into a ring of pixel pack buffers and are only mapped a few frames
+// later once the gpu is done with them, then a writer thread does the slow
+// part (flip, colour conversion, file io).
+//
+// paths ending in .y4m are written as yuv4mpeg2 (4:4:4), anything else as a
+// stream of binary ppm images, both of which ffmpeg reads directly
+//
+// the video runs on its own clock at fps, fed the simulation time of each
+// rendered frame. frames rendered faster than that are skipped and slower
+// ones repeated, so the file plays back at the right speed whatever the
+// render rate or vsync setting
+class FrameCapture {
+public:
+    FrameCapture( const char* path, int width, int height, int fps = 60 ) {
+        this->width = width;
+        this->height = height;
+        this->fps = fps;
+        frame_bytes = width * height * 4;
+        frames_due = 0;
+        start_time = 0.0;
+        frames_written = 0;
+        writer_stalls = 0;
+        head = 0;
+        stopping = false;
+
+        std::string path_string( path );
+        y4m = path_string.size() >= 4 && path_string.compare( path_string.size() - 4, 4, ".y4m" ) == 0;
+
+        file.open( path, std::ios::binary | std::ios::trunc );
+        if ( !file.is_open() ) {
+            std::cerr << "failed to open capture file " << path << std::endl;
+        } else if ( y4m ) {
+            file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+        }
+
+        // pack buffers for the async readback ring
+        for ( int i = 0; i < RING_SIZE; i++ ) {
+            slots[ i ].pbo = make_buffer( "capture pack buffer" );
+            gpu_memory().buffer_data( GL_PIXEL_PACK_BUFFER, slots[ i ].pbo.get(), frame_bytes, NULL, GL_STREAM_READ );
+        }
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+        // cpu side frames handed to the writer, allocated once up front.
+        // enough for half a second of video so a slow write or two doesn't
+        // hold up rendering, within a memory budget for big frames
+        int pool_size = std::max( (int) MIN_POOL_SIZE, std::min( fps / 2, (int) POOL_BUDGET / frame_bytes ) );
+        buffers.resize( pool_size );
+        for ( int i = 0; i < pool_size; i++ ) {
+            buffers[ i ].resize( frame_bytes );
+            free_buffers.push_back( i );
+        }
+
+        writer = std::thread( &FrameCapture::writer_loop, this );
+    }
+
+    ~FrameCapture() {
+        finish();
+    }
+
+    // queue a read of the framebuffer's colour attachment if time, in
+    // seconds, has reached the video's next frame. the pixels reach the
+    // writer RING_SIZE - 1 captures later
+    void capture( Framebuffer* source, double time ) {
+        // the video starts at the first capture. one copy for every video
+        // frame up to and including this time, nudged so a time landing
+        // exactly on a frame doesn't round down to the one before
+        if ( frames_due == 0 ) {
+            start_time = time;
+        }
+        long long due = (long long) std::floor( ( time - start_time ) * fps + 1e-6 ) + 1;
+        if ( due <= frames_due ) {
+            return;
+        }
+
+        Slot& slot = slots[ head ];
+
+        // the slot we're about to reuse holds the oldest read, hand it off first
+        if ( slot.fence ) {
+            retire( slot );
+        }
+
+        gl_state().bind_framebuffer( GL_READ_FRAMEBUFFER, source->id.get() );
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, slot.pbo.get() );
+        glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+        slot.fence = make_fence();
+        slot.copies = (unsigned int) ( due - frames_due );
+        frames_due = due;
+
+        head = ( head + 1 ) % RING_SIZE;
+    }
+
+    // flush every pending read and wait for the writer to drain. has to be
+    // called while the gl context is still alive
+    void finish() {
+        if ( !writer.joinable() ) {
+            return;
+        }
+
+        // retire in submission order, starting from the oldest slot
+        for ( int i = 0; i < RING_SIZE; i++ ) {
+            Slot& slot = slots[ ( head + i ) % RING_SIZE ];
+            if ( slot.fence ) {
+                retire( slot );
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            stopping = true;
+        }
+        queue_changed.notify_all();
+        writer.join();
+
+        file.close();
+        std::cout << "captured " << frames_written << " frames at " << fps << "fps";
+        if ( writer_stalls > 0 ) {
+            std::cout << " (render loop waited on the writer " << writer_stalls << " times)";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    static const int RING_SIZE = 3;
+    static const int MIN_POOL_SIZE = 8;
+    static const int POOL_BUDGET = 256 * 1024 * 1024;
+
+    struct Slot {
+        BufferHandle pbo;
+        FenceHandle fence;
+        // video frames this read fills
+        unsigned int copies;
+    };
+
+    // a frame handed to the writer
+    struct Queued {
+        int index;
+        unsigned int copies;
+    };
+
+    int width, height;
+    int fps;
+    int frame_bytes;
+    // video frames queued so far, counting repeats, from start_time on
+    long long frames_due;
+    double start_time;
+    bool y4m;
+    std::ofstream file;
+
+    Slot slots[ RING_SIZE ];
+    int head;
+
+    std::vector<std::vector<unsigned char>> buffers;
+    std::deque<int> free_buffers;
+    std::deque<Queued> queued_buffers;
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    std::thread writer;
+    bool stopping;
+    unsigned int frames_written;
+    unsigned int writer_stalls;
+
+    // copy a finished read out of its pack buffer and queue it for writing
+    void retire( Slot& slot ) {
+        // normally signalled long ago, this only blocks if the gpu is behind
+        glClientWaitSync( slot.fence.get(), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+        slot.fence.reset();
+
+        // grab a free cpu buffer. if the writer has fallen behind, wait for it
+        // rather than dropping frames from the recording
+        int index;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            if ( free_buffers.empty() ) {
+                writer_stalls++;
+                queue_changed.wait( lock, [ this ] { return !free_buffers.empty(); } );
+            }
+            index = free_buffers.front();
+            free_buffers.pop_front();
+        }
+
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, slot.pbo.get() );
+        void* pixels = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, frame_bytes, GL_MAP_READ_BIT );
+        if ( pixels != NULL ) {
+            memcpy( buffers[ index ].data(), pixels, frame_bytes );
+            glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+        }
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            queued_buffers.push_back( { index, slot.copies } );
+        }
+        queue_changed.notify_all();
+    }
+
+    void writer_loop() {
+        // scratch space for one converted frame, rgb or three yuv planes
+        std::vector<unsigned char> out( width * height * 3 );
+
+        while ( true ) {
+            Queued frame;
+            {
+                std::unique_lock<std::mutex> lock( mutex );
+                queue_changed.wait( lock, [ this ] { return stopping || !queued_buffers.empty(); } );
+                if ( queued_buffers.empty() ) {
+                    return;
+                }
+                frame = queued_buffers.front();
+                queued_buffers.pop_front();
+            }
+
+            int index = frame.index;
+            if ( y4m ) {
+                convert_yuv( buffers[ index ].data(), out.data() );
+            } else {
+                convert_rgb( buffers[ index ].data(), out.data() );
+            }
+
+            // converted once, written once per video frame it covers
+            for ( unsigned int i = 0; i < frame.copies; i++ ) {
+                if ( y4m ) {
+                    file << "FRAME\n";
+                } else {
+                    file << "P6\n" << width << " " << height << "\n255\n";
+                }
+                file.write( (const char*) out.data(), out.size() );
+                frames_written++;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock( mutex );
+                free_buffers.push_back( index );
+            }
+            queue_changed.notify_all();
+        }
+    }
+
+    // gl rows are bottom up, both output formats are top down
+    void convert_rgb( const unsigned char* rgba, unsigned char* rgb ) {
+        for ( int y = 0; y < height; y++ ) {
+            const unsigned char* row = rgba + ( height - 1 - y ) * width * 4;
+            for ( int x = 0; x < width; x++ ) {
+                *rgb++ = row[ x * 4 + 0 ];
+                *rgb++ = row[ x * 4 + 1 ];
+                *rgb++ = row[ x * 4 + 2 ];
+            }
+        }
+    }
+
+    // bt.601 limited range, planar y then u then v
+    void convert_yuv( const unsigned char* rgba, unsigned char* yuv ) {
+        int plane = width * height;
+        unsigned char* y_plane = yuv;
+        unsigned char* u_plane = yuv + plane;
+        unsigned char* v_plane = yuv + plane * 2;
+
+        for ( int y = 0; y < height; y++ ) {
+            const unsigned char* row = rgba + ( height - 1 - y ) * width * 4;
+            for ( int x = 0; x < width; x++ ) {
+                int r = row[ x * 4 + 0 ];
+                int g = row[ x * 4 + 1 ];
+                int b = row[ x * 4 + 2 ];
+
+                *y_plane++ = (unsigned char) ( ( (  66 * r + 129 * g +  25 * b + 128 ) >> 8 ) +  16 );
+                *u_plane++ = (unsigned char) ( ( ( -38 * r -  74 * g + 112 * b + 128 ) >> 8 ) + 128 );
+                *v_plane++ = (unsigned char) ( ( ( 112 * r -  94 * g -  18 * b + 128 ) >> 8 ) + 128 );
+            }
+        }
+    }
+};
+
+#endif
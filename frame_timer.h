@@ -0,0 +1,69 @@
+#ifndef FRAME_TIMER_H
+#define FRAME_TIMER_H
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// records how long each frame took, start of one frame to start of the next,
+// and prints the distribution at the end of a run
+class FrameTimer {
+public:
+    FrameTimer( unsigned int expected_frames = 0 ) {
+        // avoid growing the sample buffer mid run when we know the length
+        frame_times.reserve( expected_frames > 0 ? expected_frames : 4096 );
+        started = false;
+    }
+
+    // call once at the top of every frame
+    void tick() {
+        auto now = std::chrono::steady_clock::now();
+        if ( started ) {
+            frame_times.push_back( std::chrono::duration<double, std::milli>( now - last ).count() );
+        } else {
+            first = now;
+            started = true;
+        }
+        last = now;
+    }
+
+    // closes off the frame in flight, call once after the loop exits
+    void stop() {
+        tick();
+    }
+
+    void print_summary( std::ostream& out ) {
+        if ( frame_times.empty() ) {
+            return;
+        }
+
+        std::vector<double> sorted( frame_times );
+        std::sort( sorted.begin(), sorted.end() );
+
+        double total = std::chrono::duration<double, std::milli>( last - first ).count();
+        double mean = total / sorted.size();
+
+        out << "frames: " << sorted.size() << " in " << total / 1000.0 << "s";
+        out << " (" << 1000.0 / mean << " fps)\n";
+        out << "frame time ms: mean " << mean;
+        out << ", p50 " << percentile( sorted, 0.50 );
+        out << ", p99 " << percentile( sorted, 0.99 );
+        out << ", max " << sorted.back();
+        out << std::endl;
+    }
+
+private:
+    std::vector<double> frame_times;
+    std::chrono::steady_clock::time_point first, last;
+    bool started;
+
+    // nearest rank on an already sorted list
+    double percentile( const std::vector<double>& sorted, double p ) {
+        size_t rank = (size_t) ( p * sorted.size() + 0.5 );
+        rank = std::min( std::max( rank, (size_t) 1 ), sorted.size() );
+        return sorted[ rank - 1 ];
+    }
+};
+
+#endif
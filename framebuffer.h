@@ -0,0 +1,58 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h>
+
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+#include <iostream>
+
+// offscreen render target, rgba8 colour texture with no depth. move only
+class Framebuffer {
+public:
+    FramebufferHandle id;
+    TextureHandle color_tex;
+    int width, height;
+
+    Framebuffer( int width, int height ) {
+        this->width = width;
+        this->height = height;
+
+        id = make_framebuffer();
+        gl_state().bind_framebuffer( GL_FRAMEBUFFER, id.get() );
+
+        color_tex = make_texture( "offscreen colour" );
+        gpu_memory().tex_image_2d( color_tex.get(), GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+
+        glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_tex.get(), 0 );
+
+        if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+            std::cerr << "offscreen framebuffer is incomplete" << std::endl;
+        }
+
+        gl_state().bind_framebuffer( GL_FRAMEBUFFER, 0 );
+    }
+
+    // bind as the draw target and match the viewport to it
+    void bind() {
+        gl_state().bind_framebuffer( GL_FRAMEBUFFER, id.get() );
+        glViewport( 0, 0, width, height );
+    }
+
+    // copy the colour attachment onto the window, stretched to its size
+    void blit_to_default( int dst_width, int dst_height ) {
+        gl_state().bind_framebuffer( GL_READ_FRAMEBUFFER, id.get() );
+        gl_state().bind_framebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+        glBlitFramebuffer(
+            0, 0, width, height,
+            0, 0, dst_width, dst_height,
+            GL_COLOR_BUFFER_BIT, GL_NEAREST );
+        gl_state().bind_framebuffer( GL_FRAMEBUFFER, 0 );
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// more information at https://www.khronos.org/opengl/wiki/Debug_Output
+
+const char* gl_debug_source_name( GLenum source ) {
+    switch ( source ) {
+        case GL_DEBUG_SOURCE_API: return "GL_DEBUG_SOURCE_API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "GL_DEBUG_SOURCE_WINDOW_SYSTEM";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "GL_DEBUG_SOURCE_SHADER_COMPILER";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "GL_DEBUG_SOURCE_THIRD_PARTY";
+        case GL_DEBUG_SOURCE_APPLICATION: return "GL_DEBUG_SOURCE_APPLICATION";
+        case GL_DEBUG_SOURCE_OTHER: return "GL_DEBUG_SOURCE_OTHER";
+        default: return "UNKNOWN";
+    }
+}
+
+const char* gl_debug_type_name( GLenum type ) {
+    switch ( type ) {
+        case GL_DEBUG_TYPE_ERROR: return "GL_DEBUG_TYPE_ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR";
+        case GL_DEBUG_TYPE_PORTABILITY: return "GL_DEBUG_TYPE_PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "GL_DEBUG_TYPE_PERFORMANCE";
+        case GL_DEBUG_TYPE_MARKER: return "GL_DEBUG_TYPE_MARKER";
+        case GL_DEBUG_TYPE_PUSH_GROUP: return "GL_DEBUG_TYPE_PUSH_GROUP";
+        case GL_DEBUG_TYPE_POP_GROUP: return "GL_DEBUG_TYPE_POP_GROUP";
+        case GL_DEBUG_TYPE_OTHER: return "GL_DEBUG_TYPE_OTHER";
+        default: return "UNKNOWN";
+    }
+}
+
+const char* gl_debug_severity_name( GLenum severity ) {
+    switch ( severity ) {
+        case GL_DEBUG_SEVERITY_HIGH: return "GL_DEBUG_SEVERITY_HIGH";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "GL_DEBUG_SEVERITY_MEDIUM";
+        case GL_DEBUG_SEVERITY_LOW: return "GL_DEBUG_SEVERITY_LOW";
+        case GL_DEBUG_SEVERITY_NOTIFICATION: return "GL_DEBUG_SEVERITY_NOTIFICATION";
+        default: return "UNKNOWN";
+    }
+}
+
+// gl debug output that is cheap enough to leave on. the callback runs on
+// whatever thread the driver likes, so it only classifies the message,
+// bumps counters, and copies it into a fixed queue. repeats of the same
+// message are rate limited per time window, and a writer thread does the
+// printing
+class GLDebug {
+public:
+    // messages less severe than this are filtered out in the driver
+    GLenum min_severity;
+    // how many times one message is printed per window before the rest of
+    // the window's repeats are only counted
+    unsigned int max_repeats;
+    unsigned int window_ms;
+
+    GLDebug() {
+        min_severity = GL_DEBUG_SEVERITY_LOW;
+        max_repeats = 3;
+        window_ms = 1000;
+        start_time = std::chrono::steady_clock::now();
+        running = false;
+        total = 0;
+        suppressed = 0;
+        dropped = 0;
+        performance_warnings = 0;
+        enqueue_pos = 0;
+        dequeue_pos = 0;
+
+        for ( int i = 0; i < QUEUE_SIZE; i++ ) {
+            queue[ i ].sequence = i;
+        }
+        for ( int i = 0; i < SEEN_SIZE; i++ ) {
+            seen[ i ].key = 0;
+            seen[ i ].window = 0;
+            seen[ i ].count = 0;
+            seen[ i ].missed = 0;
+        }
+    }
+
+    ~GLDebug() {
+        stop();
+    }
+
+    // hook the callback up to the current context and start the writer
+    void start() {
+        if ( running ) {
+            return;
+        }
+
+        running = true;
+        writer = std::thread( &GLDebug::writer_loop, this );
+
+        glEnable( GL_DEBUG_OUTPUT );
+        glDebugMessageCallback( callback, this );
+
+        // drop everything below the threshold before it ever reaches us
+        glDebugMessageControl( GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE );
+        const GLenum severities[] = {
+            GL_DEBUG_SEVERITY_HIGH,
+            GL_DEBUG_SEVERITY_MEDIUM,
+            GL_DEBUG_SEVERITY_LOW,
+            GL_DEBUG_SEVERITY_NOTIFICATION,
+        };
+        for ( GLenum severity : severities ) {
+            glDebugMessageControl( GL_DONT_CARE, GL_DONT_CARE, severity, 0, NULL, GL_TRUE );
+            if ( severity == min_severity ) {
+                break;
+            }
+        }
+    }
+
+    // detach from the context and flush the writer
+    void stop() {
+        if ( !running ) {
+            return;
+        }
+
+        glDebugMessageCallback( NULL, NULL );
+        glDisable( GL_DEBUG_OUTPUT );
+
+        running = false;
+        writer.join();
+    }
+
+    void print_summary( std::ostream& out ) {
+        out << "gl debug: " << total << " messages, " << suppressed << " repeats suppressed, "
+            << performance_warnings << " performance warnings";
+        if ( dropped > 0 ) {
+            out << ", " << dropped << " dropped (queue full)";
+        }
+        out << std::endl;
+    }
+
+private:
+    static const int QUEUE_SIZE = 256;
+    static const int SEEN_SIZE = 512;
+    static const int MESSAGE_LENGTH = 256;
+
+    struct Message {
+        std::atomic<size_t> sequence;
+        const char* source;
+        const char* type;
+        const char* severity;
+        GLuint id;
+        unsigned int repeat;
+        // repeats suppressed in earlier windows since this id last printed
+        unsigned int missed;
+        char text[ MESSAGE_LENGTH ];
+    };
+
+    struct Seen {
+        std::atomic<uint64_t> key;
+        // window the count is for, and repeats suppressed since the last
+        // one that printed
+        std::atomic<unsigned int> window;
+        std::atomic<unsigned int> count;
+        std::atomic<unsigned int> missed;
+    };
+
+    // bounded multi producer queue, each slot's sequence says whose turn it is
+    Message queue[ QUEUE_SIZE ];
+    std::atomic<size_t> enqueue_pos;
+    size_t dequeue_pos;
+
+    // open addressing table of message keys, never cleared. counts are
+    // reset when a message turns up in a new window
+    Seen seen[ SEEN_SIZE ];
+    std::chrono::steady_clock::time_point start_time;
+
+    std::thread writer;
+    std::atomic<bool> running;
+
+    std::atomic<unsigned int> total;
+    std::atomic<unsigned int> suppressed;
+    std::atomic<unsigned int> dropped;
+    std::atomic<unsigned int> performance_warnings;
+
+    static void GLAPIENTRY callback( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param ) {
+        ( (GLDebug*) user_param )->receive( source, type, id, severity, length, message );
+    }
+
+    void receive( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message ) {
+        total++;
+        if ( type == GL_DEBUG_TYPE_PERFORMANCE ) {
+            performance_warnings++;
+        }
+
+        unsigned int missed = 0;
+        Seen* entry = find_seen( source, type, id );
+        unsigned int repeat = entry == NULL ? max_repeats + 1 : count_repeat( *entry, missed );
+        if ( repeat > max_repeats ) {
+            suppressed++;
+            if ( entry != NULL ) {
+                entry->missed++;
+            }
+            return;
+        }
+
+        // claim a slot, or give up if the writer is a whole queue behind
+        size_t pos = enqueue_pos.load( std::memory_order_relaxed );
+        Message* slot;
+        while ( true ) {
+            slot = &queue[ pos % QUEUE_SIZE ];
+            size_t sequence = slot->sequence.load( std::memory_order_acquire );
+            if ( sequence == pos ) {
+                if ( enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                    break;
+                }
+            } else if ( sequence < pos ) {
+                dropped++;
+                return;
+            } else {
+                pos = enqueue_pos.load( std::memory_order_relaxed );
+            }
+        }
+
+        slot->source = gl_debug_source_name( source );
+        slot->type = gl_debug_type_name( type );
+        slot->severity = gl_debug_severity_name( severity );
+        slot->id = id;
+        slot->repeat = repeat;
+        slot->missed = missed;
+
+        size_t text_length = length < 0 ? strlen( message ) : (size_t) length;
+        text_length = std::min( text_length, (size_t) MESSAGE_LENGTH - 1 );
+        memcpy( slot->text, message, text_length );
+        slot->text[ text_length ] = '\0';
+
+        slot->sequence.store( pos + 1, std::memory_order_release );
+    }
+
+    // the table entry for this message, NULL once the table is full
+    Seen* find_seen( GLenum source, GLenum type, GLuint id ) {
+        // zero marks an empty entry, so keep it out of real keys
+        uint64_t key = ( (uint64_t) id << 32 ) ^ ( (uint64_t) ( source & 0xffff ) << 16 ) ^ ( type & 0xffff ) ^ 1;
+        size_t start = ( key * 0x9e3779b97f4a7c15ull ) >> 55;
+
+        for ( int i = 0; i < SEEN_SIZE; i++ ) {
+            Seen& entry = seen[ ( start + i ) % SEEN_SIZE ];
+            uint64_t existing = entry.key.load( std::memory_order_acquire );
+
+            if ( existing == 0 ) {
+                uint64_t empty = 0;
+                if ( entry.key.compare_exchange_strong( empty, key ) || empty == key ) {
+                    return &entry;
+                }
+                existing = empty;
+            }
+
+            if ( existing == key ) {
+                return &entry;
+            }
+        }
+
+        return NULL;
+    }
+
+    // how many times this message has been seen in the current window,
+    // including now. the first time in a new window also hands back how
+    // many were suppressed before it. a message racing the rollover may be
+    // counted in either window, which only moves the cutoff by one
+    unsigned int count_repeat( Seen& entry, unsigned int& missed ) {
+        // windows count from 1, a fresh entry's 0 always rolls over
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        unsigned int window = 1 + (unsigned int)
+            ( std::chrono::duration_cast<std::chrono::milliseconds>( elapsed ).count() / std::max( window_ms, 1u ) );
+
+        unsigned int last = entry.window.load( std::memory_order_relaxed );
+        if ( last != window && entry.window.compare_exchange_strong( last, window ) ) {
+            entry.count = 0;
+            missed = entry.missed.exchange( 0 );
+        }
+
+        return ++entry.count;
+    }
+
+    void writer_loop() {
+        while ( true ) {
+            bool keep_going = running;
+
+            Message& slot = queue[ dequeue_pos % QUEUE_SIZE ];
+            if ( slot.sequence.load( std::memory_order_acquire ) != dequeue_pos + 1 ) {
+                if ( !keep_going ) {
+                    return;
+                }
+                std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+                continue;
+            }
+
+            std::cerr << "GL CALLBACK:\n";
+            std::cerr << "source: " << slot.source << "\n";
+            std::cerr << "type: " << slot.type << "\n";
+            std::cerr << "severity: " << slot.severity << "\n";
+            std::cerr << "id: " << slot.id << "\n";
+            std::cerr << "message: " << slot.text << "\n";
+            if ( slot.missed > 0 ) {
+                std::cerr << "(" << slot.missed << " repeats of this message were suppressed before this)\n";
+            }
+            if ( slot.repeat == max_repeats ) {
+                std::cerr << "(further repeats of this message are suppressed for the rest of this " << window_ms << "ms window)\n";
+            }
+            std::cerr << std::endl;
+
+            slot.sequence.store( dequeue_pos + QUEUE_SIZE, std::memory_order_release );
+            dequeue_pos++;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// our glad loader is plain 4.3 core, so anything newer gets checked for at
+// runtime and its enums defined here
+
+// GL_ARB_pipeline_statistics_query
+#define GL_VERTICES_SUBMITTED_ARB 0x82EE
+#define GL_PRIMITIVES_SUBMITTED_ARB 0x82EF
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB 0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#define GL_COMPUTE_SHADER_INVOCATIONS_ARB 0x82F5
+#define GL_CLIPPING_INPUT_PRIMITIVES_ARB 0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES_ARB 0x82F7
+
+// GL_KHR_shader_subgroup
+#define GL_SUBGROUP_SIZE_KHR 0x9532
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR 0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+#define GL_SUBGROUP_FEATURE_BASIC_BIT_KHR 0x00000001
+#define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR 0x00000004
+
+bool has_gl_extension( const char* name ) {
+    GLint count = 0;
+    glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+
+    for ( GLint i = 0; i < count; i++ ) {
+        const char* extension = (const char*) glGetStringi( GL_EXTENSIONS, i );
+        if ( extension != NULL && strcmp( extension, name ) == 0 ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif
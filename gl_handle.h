@@ -0,0 +1,139 @@
+#ifndef GL_HANDLE_H
+#define GL_HANDLE_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+// owns one gl object and deletes it on destruction. move only, so an object
+// has exactly one owner and classes holding these can go in containers or be
+// handed between stages without creating anything new in gl
+template <typename T, typename Traits>
+class GLHandle {
+public:
+    GLHandle() {
+        id = T();
+    }
+
+    explicit GLHandle( T id ) {
+        this->id = id;
+    }
+
+    ~GLHandle() {
+        reset();
+    }
+
+    GLHandle( const GLHandle& ) = delete;
+    GLHandle& operator=( const GLHandle& ) = delete;
+
+    GLHandle( GLHandle&& other ) {
+        id = other.release();
+    }
+
+    GLHandle& operator=( GLHandle&& other ) {
+        if ( this != &other ) {
+            reset( other.release() );
+        }
+        return *this;
+    }
+
+    T get() const {
+        return id;
+    }
+
+    explicit operator bool() const {
+        return id != T();
+    }
+
+    // give up ownership without deleting
+    T release() {
+        T old = id;
+        id = T();
+        return old;
+    }
+
+    // delete what we hold, if anything, and take over new_id
+    void reset( T new_id = T() ) {
+        if ( id != T() ) {
+            Traits::destroy( id );
+        }
+        id = new_id;
+    }
+
+private:
+    T id;
+};
+
+struct ProgramTraits {
+    static void destroy( unsigned int id ) { gl_state().delete_program( id ); }
+};
+
+struct BufferTraits {
+    static void destroy( unsigned int id ) { gpu_memory().delete_buffer( id ); }
+};
+
+struct TextureTraits {
+    static void destroy( unsigned int id ) { gpu_memory().delete_texture( id ); }
+};
+
+struct VertexArrayTraits {
+    static void destroy( unsigned int id ) { gl_state().delete_vertex_array( id ); }
+};
+
+struct FramebufferTraits {
+    static void destroy( unsigned int id ) { gl_state().delete_framebuffer( id ); }
+};
+
+struct QueryTraits {
+    static void destroy( unsigned int id ) { glDeleteQueries( 1, &id ); }
+};
+
+struct FenceTraits {
+    static void destroy( GLsync fence ) { glDeleteSync( fence ); }
+};
+
+typedef GLHandle<unsigned int, ProgramTraits> ProgramHandle;
+typedef GLHandle<unsigned int, BufferTraits> BufferHandle;
+typedef GLHandle<unsigned int, TextureTraits> TextureHandle;
+typedef GLHandle<unsigned int, VertexArrayTraits> VertexArrayHandle;
+typedef GLHandle<unsigned int, FramebufferTraits> FramebufferHandle;
+typedef GLHandle<unsigned int, QueryTraits> QueryHandle;
+typedef GLHandle<GLsync, FenceTraits> FenceHandle;
+
+// buffers and textures are created through the memory registry so they're
+// counted and labelled
+BufferHandle make_buffer( const std::string& label ) {
+    return BufferHandle( gpu_memory().gen_buffer( label ) );
+}
+
+TextureHandle make_texture( const std::string& label ) {
+    return TextureHandle( gpu_memory().gen_texture( label ) );
+}
+
+VertexArrayHandle make_vertex_array() {
+    unsigned int id;
+    glGenVertexArrays( 1, &id );
+    return VertexArrayHandle( id );
+}
+
+FramebufferHandle make_framebuffer() {
+    unsigned int id;
+    glGenFramebuffers( 1, &id );
+    return FramebufferHandle( id );
+}
+
+QueryHandle make_query() {
+    unsigned int id;
+    glGenQueries( 1, &id );
+    return QueryHandle( id );
+}
+
+// a fence that signals once everything submitted so far has finished
+FenceHandle make_fence() {
+    return FenceHandle( glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ) );
+}
+
+#endif
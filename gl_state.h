@@ -0,0 +1,236 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// shadows the gl binding state so rebinding what's already bound costs
+// nothing. only works if every bind and delete of the tracked kinds goes
+// through here, call invalidate() after anything else touches them
+class GLState {
+public:
+    // calls forwarded to gl vs calls skipped because nothing would change
+    unsigned long long issued;
+    unsigned long long skipped;
+
+    GLState() {
+        issued = 0;
+        skipped = 0;
+        invalidate();
+    }
+
+    // forget everything, the next bind of each kind always goes to gl
+    void invalidate() {
+        program = UNKNOWN;
+        active_unit = UNKNOWN;
+        vertex_array = UNKNOWN;
+        draw_framebuffer = UNKNOWN;
+        read_framebuffer = UNKNOWN;
+
+        for ( int i = 0; i < BUFFER_TARGET_COUNT; i++ ) {
+            buffers[ i ] = UNKNOWN;
+        }
+        for ( int unit = 0; unit < TEXTURE_UNIT_COUNT; unit++ ) {
+            for ( int i = 0; i < TEXTURE_TARGET_COUNT; i++ ) {
+                textures[ unit ][ i ] = UNKNOWN;
+            }
+        }
+    }
+
+    void use_program( unsigned int id ) {
+        if ( changed( program, id ) ) {
+            glUseProgram( id );
+        }
+    }
+
+    // takes the unit index, not GL_TEXTUREn
+    void active_texture( unsigned int unit ) {
+        if ( changed( active_unit, unit ) ) {
+            glActiveTexture( GL_TEXTURE0 + unit );
+        }
+    }
+
+    // binds to the active unit
+    void bind_texture( GLenum target, unsigned int id ) {
+        int index = texture_index( target );
+        if ( index < 0 || active_unit >= TEXTURE_UNIT_COUNT ) {
+            issued++;
+            glBindTexture( target, id );
+            return;
+        }
+
+        if ( changed( textures[ active_unit ][ index ], id ) ) {
+            glBindTexture( target, id );
+        }
+    }
+
+    void bind_buffer( GLenum target, unsigned int id ) {
+        // the element buffer binding lives in the vao, so there's nothing
+        // to track while the vao is unknown
+        if ( target == GL_ELEMENT_ARRAY_BUFFER && vertex_array == UNKNOWN ) {
+            issued++;
+            glBindBuffer( target, id );
+            return;
+        }
+
+        int index = buffer_index( target );
+        if ( index < 0 ) {
+            issued++;
+            glBindBuffer( target, id );
+            return;
+        }
+
+        if ( changed( buffers[ index ], id ) ) {
+            glBindBuffer( target, id );
+        }
+    }
+
+    // glBindBufferBase sets the generic binding as well as the indexed one
+    void bind_buffer_base( GLenum target, unsigned int index, unsigned int id ) {
+        issued++;
+        glBindBufferBase( target, index, id );
+
+        int generic = buffer_index( target );
+        if ( generic >= 0 ) {
+            buffers[ generic ] = id;
+        }
+    }
+
+    void bind_vertex_array( unsigned int id ) {
+        if ( changed( vertex_array, id ) ) {
+            glBindVertexArray( id );
+
+            // switching vao switches the element buffer with it
+            buffers[ buffer_index( GL_ELEMENT_ARRAY_BUFFER ) ] = UNKNOWN;
+        }
+    }
+
+    // GL_FRAMEBUFFER binds both draw and read, like in gl
+    void bind_framebuffer( GLenum target, unsigned int id ) {
+        bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+        bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+
+        if ( ( draw && draw_framebuffer != id ) || ( read && read_framebuffer != id ) ) {
+            issued++;
+            glBindFramebuffer( target, id );
+            if ( draw ) {
+                draw_framebuffer = id;
+            }
+            if ( read ) {
+                read_framebuffer = id;
+            }
+        } else {
+            skipped++;
+        }
+    }
+
+    // deleting a bound object unbinds it in gl, and its name can be handed
+    // out again, so the shadow state has to drop it too
+    void delete_program( unsigned int id ) {
+        glDeleteProgram( id );
+        if ( program == id ) {
+            program = UNKNOWN;
+        }
+    }
+
+    void delete_texture( unsigned int id ) {
+        glDeleteTextures( 1, &id );
+        for ( int unit = 0; unit < TEXTURE_UNIT_COUNT; unit++ ) {
+            for ( int i = 0; i < TEXTURE_TARGET_COUNT; i++ ) {
+                forget( textures[ unit ][ i ], id );
+            }
+        }
+    }
+
+    void delete_buffer( unsigned int id ) {
+        glDeleteBuffers( 1, &id );
+        for ( int i = 0; i < BUFFER_TARGET_COUNT; i++ ) {
+            forget( buffers[ i ], id );
+        }
+    }
+
+    void delete_vertex_array( unsigned int id ) {
+        glDeleteVertexArrays( 1, &id );
+        if ( vertex_array == id ) {
+            vertex_array = UNKNOWN;
+            buffers[ buffer_index( GL_ELEMENT_ARRAY_BUFFER ) ] = UNKNOWN;
+        }
+    }
+
+    void delete_framebuffer( unsigned int id ) {
+        glDeleteFramebuffers( 1, &id );
+        forget( draw_framebuffer, id );
+        forget( read_framebuffer, id );
+    }
+
+    void print_summary( std::ostream& out ) {
+        out << "gl state: " << issued << " binds issued, " << skipped << " redundant binds skipped" << std::endl;
+    }
+
+private:
+    static const unsigned int UNKNOWN = 0xffffffff;
+    static const int TEXTURE_UNIT_COUNT = 16;
+    static const int TEXTURE_TARGET_COUNT = 3;
+    static const int BUFFER_TARGET_COUNT = 11;
+
+    unsigned int program;
+    unsigned int active_unit;
+    unsigned int vertex_array;
+    unsigned int draw_framebuffer, read_framebuffer;
+    unsigned int buffers[ BUFFER_TARGET_COUNT ];
+    unsigned int textures[ TEXTURE_UNIT_COUNT ][ TEXTURE_TARGET_COUNT ];
+
+    // updates the shadow value, true if gl needs to hear about it
+    bool changed( unsigned int& current, unsigned int id ) {
+        if ( current == id ) {
+            skipped++;
+            return false;
+        }
+
+        issued++;
+        current = id;
+        return true;
+    }
+
+    // a deleted name reverts to 0 in gl
+    void forget( unsigned int& current, unsigned int id ) {
+        if ( current == id ) {
+            current = 0;
+        }
+    }
+
+    int texture_index( GLenum target ) {
+        switch ( target ) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_3D: return 1;
+            case GL_TEXTURE_2D_ARRAY: return 2;
+            default: return -1;
+        }
+    }
+
+    int buffer_index( GLenum target ) {
+        switch ( target ) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_PIXEL_PACK_BUFFER: return 2;
+            case GL_PIXEL_UNPACK_BUFFER: return 3;
+            case GL_SHADER_STORAGE_BUFFER: return 4;
+            case GL_UNIFORM_BUFFER: return 5;
+            case GL_DISPATCH_INDIRECT_BUFFER: return 6;
+            case GL_DRAW_INDIRECT_BUFFER: return 7;
+            case GL_COPY_READ_BUFFER: return 8;
+            case GL_COPY_WRITE_BUFFER: return 9;
+            case GL_ATOMIC_COUNTER_BUFFER: return 10;
+            default: return -1;
+        }
+    }
+};
+
+// one context per process here, so one shared state
+GLState& gl_state() {
+    static GLState state;
+    return state;
+}
+
+#endif
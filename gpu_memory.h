@@ -0,0 +1,209 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "gl_state.h"
+
+// every buffer and texture we create goes through here, so we know how much
+// gpu memory we're holding, the most we ever held, and what was never freed.
+// objects get a debug label too, which shows up in gl debug messages and
+// in tools like renderdoc
+class GpuMemory {
+public:
+    size_t current_bytes;
+    size_t peak_bytes;
+
+    GpuMemory() {
+        current_bytes = 0;
+        peak_bytes = 0;
+    }
+
+    // runs at exit, after everything that should have freed its objects has
+    ~GpuMemory() {
+        report_leaks( std::cerr );
+    }
+
+    unsigned int gen_buffer( const std::string& label ) {
+        unsigned int id;
+        glGenBuffers( 1, &id );
+        buffers[ id ] = { label, 0, false, GL_NONE, GL_NONE };
+        return id;
+    }
+
+    unsigned int gen_texture( const std::string& label ) {
+        unsigned int id;
+        glGenTextures( 1, &id );
+        textures[ id ] = { label, 0, false, GL_NONE, GL_NONE };
+        return id;
+    }
+
+    // glBufferData, binding the buffer to target first
+    void buffer_data( GLenum target, unsigned int id, size_t bytes, const void* data, GLenum usage ) {
+        gl_state().bind_buffer( target, id );
+        glBufferData( target, bytes, data, usage );
+        resize( buffers, GL_BUFFER, id, bytes );
+    }
+
+    // glTexImage2D on the active unit, binding the texture first
+    void tex_image_2d( unsigned int id, GLenum internal_format, int width, int height, GLenum format, GLenum type, const void* data ) {
+        gl_state().bind_texture( GL_TEXTURE_2D, id );
+        glTexImage2D( GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, data );
+        resize( textures, GL_TEXTURE, id, (size_t) width * height * texel_bytes( internal_format ) );
+        describe( id, GL_TEXTURE_2D, internal_format );
+    }
+
+    // glTexImage3D on the active unit, binding the texture first
+    void tex_image_3d( unsigned int id, GLenum internal_format, int width, int height, int depth, GLenum format, GLenum type, const void* data ) {
+        gl_state().bind_texture( GL_TEXTURE_3D, id );
+        glTexImage3D( GL_TEXTURE_3D, 0, internal_format, width, height, depth, 0, format, type, data );
+        resize( textures, GL_TEXTURE, id, (size_t) width * height * depth * texel_bytes( internal_format ) );
+        describe( id, GL_TEXTURE_3D, internal_format );
+    }
+
+    // what a texture was last allocated as, false if it never went through
+    // tex_image_2d/3d. gl 4.3 can't tell us a texture's target from its id
+    bool texture_format( unsigned int id, GLenum& target, GLenum& internal_format ) {
+        auto it = textures.find( id );
+        if ( it == textures.end() || it->second.target == GL_NONE ) {
+            return false;
+        }
+
+        target = it->second.target;
+        internal_format = it->second.internal_format;
+        return true;
+    }
+
+    void delete_buffer( unsigned int id ) {
+        release( buffers, id );
+        gl_state().delete_buffer( id );
+    }
+
+    void delete_texture( unsigned int id ) {
+        release( textures, id );
+        gl_state().delete_texture( id );
+    }
+
+    void print_summary( std::ostream& out ) {
+        out << "gpu memory: " << megabytes( current_bytes ) << "MB held, ";
+        out << megabytes( peak_bytes ) << "MB peak, ";
+        out << buffers.size() << " buffers, " << textures.size() << " textures" << std::endl;
+    }
+
+    void report_leaks( std::ostream& out ) {
+        if ( buffers.empty() && textures.empty() ) {
+            return;
+        }
+
+        out << "gpu memory: " << buffers.size() + textures.size() << " objects never deleted ("
+            << megabytes( current_bytes ) << "MB)\n";
+        for ( auto& b : buffers ) {
+            out << "  buffer " << b.first << " \"" << b.second.label << "\" " << b.second.bytes << " bytes\n";
+        }
+        for ( auto& t : textures ) {
+            out << "  texture " << t.first << " \"" << t.second.label << "\" " << t.second.bytes << " bytes\n";
+        }
+        out << std::flush;
+    }
+
+    // bytes per texel for the internal formats we use
+    static size_t texel_bytes( GLenum internal_format ) {
+        switch ( internal_format ) {
+            case GL_R8: return 1;
+            case GL_R16F: return 2;
+            case GL_R32F: case GL_R32I: case GL_R32UI: case GL_RG16F: case GL_RGBA8: return 4;
+            case GL_RG32F: case GL_RGBA16F: return 8;
+            case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI: return 16;
+            default:
+                std::cerr << "gpu memory: unknown internal format " << internal_format << ", assuming 4 bytes" << std::endl;
+                return 4;
+        }
+    }
+
+    // glsl layout qualifier spelling of the internal formats we use
+    static const char* format_name( GLenum internal_format ) {
+        switch ( internal_format ) {
+            case GL_R8: return "r8";
+            case GL_R16F: return "r16f";
+            case GL_R32F: return "r32f";
+            case GL_R32I: return "r32i";
+            case GL_R32UI: return "r32ui";
+            case GL_RG16F: return "rg16f";
+            case GL_RGBA8: return "rgba8";
+            case GL_RG32F: return "rg32f";
+            case GL_RGBA16F: return "rgba16f";
+            case GL_RGBA32F: return "rgba32f";
+            case GL_RGBA32I: return "rgba32i";
+            case GL_RGBA32UI: return "rgba32ui";
+            default: return "unknown format";
+        }
+    }
+
+private:
+    struct Allocation {
+        std::string label;
+        size_t bytes;
+        bool labelled;
+        // textures only, GL_NONE until allocated
+        GLenum target;
+        GLenum internal_format;
+    };
+
+    std::unordered_map<unsigned int, Allocation> buffers;
+    std::unordered_map<unsigned int, Allocation> textures;
+
+    void resize( std::unordered_map<unsigned int, Allocation>& objects, GLenum identifier, unsigned int id, size_t bytes ) {
+        auto it = objects.find( id );
+        if ( it == objects.end() ) {
+            std::cerr << "gpu memory: object " << id << " was not created through the registry" << std::endl;
+            return;
+        }
+
+        Allocation& allocation = it->second;
+        current_bytes = current_bytes - allocation.bytes + bytes;
+        allocation.bytes = bytes;
+        if ( current_bytes > peak_bytes ) {
+            peak_bytes = current_bytes;
+        }
+
+        // gen only reserves a name, the object exists once it's been bound,
+        // so labelling has to wait until now
+        if ( !allocation.labelled ) {
+            glObjectLabel( identifier, id, -1, allocation.label.c_str() );
+            allocation.labelled = true;
+        }
+    }
+
+    void describe( unsigned int id, GLenum target, GLenum internal_format ) {
+        auto it = textures.find( id );
+        if ( it != textures.end() ) {
+            it->second.target = target;
+            it->second.internal_format = internal_format;
+        }
+    }
+
+    void release( std::unordered_map<unsigned int, Allocation>& objects, unsigned int id ) {
+        auto it = objects.find( id );
+        if ( it != objects.end() ) {
+            current_bytes -= it->second.bytes;
+            objects.erase( it );
+        }
+    }
+
+    static double megabytes( size_t bytes ) {
+        return bytes / ( 1024.0 * 1024.0 );
+    }
+};
+
+// shared like gl_state(), there's only one context
+GpuMemory& gpu_memory() {
+    static GpuMemory memory;
+    return memory;
+}
+
+#endif
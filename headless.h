@@ -0,0 +1,156 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+// gl context without a window, for machines with no display (and no gpu,
+// mesa's llvmpipe is fine). rendering has to go to an offscreen framebuffer
+class HeadlessContext {
+public:
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;
+
+    HeadlessContext() {
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+        surface = EGL_NO_SURFACE;
+    }
+
+    ~HeadlessContext() {
+        if ( display == EGL_NO_DISPLAY ) {
+            return;
+        }
+
+        eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+        if ( surface != EGL_NO_SURFACE ) {
+            eglDestroySurface( display, surface );
+        }
+        if ( context != EGL_NO_CONTEXT ) {
+            eglDestroyContext( display, context );
+        }
+        eglTerminate( display );
+    }
+
+    // creates a 4.3 core context (a debug one if asked) and makes it current. prefers a surfaceless
+    // display, falls back to the default display with a small pbuffer
+    bool create( int width, int height, bool debug = false ) {
+        bool surfaceless = open_surfaceless_display();
+        if ( !surfaceless && !open_default_display() ) {
+            std::cerr << "failed to initialise egl display" << std::endl;
+            return false;
+        }
+
+        EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+
+        EGLConfig config = NULL;
+        EGLint config_count = 0;
+        eglChooseConfig( display, config_attribs, &config, 1, &config_count );
+
+        // the surfaceless platform may not expose any configs, which is fine
+        // as long as we never need a surface
+        if ( config_count == 0 && !surfaceless ) {
+            std::cerr << "failed to find egl config" << std::endl;
+            return false;
+        }
+
+        if ( !eglBindAPI( EGL_OPENGL_API ) ) {
+            std::cerr << "failed to bind egl opengl api" << std::endl;
+            return false;
+        }
+
+        EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+            EGL_NONE
+        };
+
+        context = eglCreateContext(
+            display,
+            config_count > 0 ? config : EGL_NO_CONFIG_KHR,
+            EGL_NO_CONTEXT,
+            context_attribs );
+
+        if ( context == EGL_NO_CONTEXT ) {
+            std::cerr << "failed to create egl context" << std::endl;
+            return false;
+        }
+
+        if ( !surfaceless || !has_extension( "EGL_KHR_surfaceless_context" ) ) {
+            EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, width,
+                EGL_HEIGHT, height,
+                EGL_NONE
+            };
+
+            surface = eglCreatePbufferSurface( display, config, pbuffer_attribs );
+            if ( surface == EGL_NO_SURFACE ) {
+                std::cerr << "failed to create egl pbuffer surface" << std::endl;
+                return false;
+            }
+        }
+
+        if ( !eglMakeCurrent( display, surface, surface, context ) ) {
+            std::cerr << "failed to make egl context current" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // loader for glad, same role as glfwGetProcAddress
+    static void* get_proc_address( const char* name ) {
+        return (void*) eglGetProcAddress( name );
+    }
+
+private:
+    bool open_surfaceless_display() {
+        const char* client_extensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+        if ( client_extensions == NULL || strstr( client_extensions, "EGL_MESA_platform_surfaceless" ) == NULL ) {
+            return false;
+        }
+
+        auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+        if ( get_platform_display == NULL ) {
+            return false;
+        }
+
+        display = get_platform_display( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+        if ( display == EGL_NO_DISPLAY || !eglInitialize( display, NULL, NULL ) ) {
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool open_default_display() {
+        display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+        if ( display == EGL_NO_DISPLAY || !eglInitialize( display, NULL, NULL ) ) {
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool has_extension( const char* name ) {
+        const char* extensions = eglQueryString( display, EGL_EXTENSIONS );
+        return extensions != NULL && strstr( extensions, name ) != NULL;
+    }
+};
+
+#endif
@@ -1,35 +1,65 @@
 #include "main.h"
 
-int main() {
-    #pragma region glfw setup
-
-    // init glfw and some settings
-    glfwInit();
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 3 );
-    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
-
-    // create window object
-    GLFWwindow* window = glfwCreateWindow(
-        WINDOW_WIDTH,
-        WINDOW_HEIGHT,
-        "compute shader test",
-        NULL,
-        NULL );
-
-    // ensure creation was successful 
-    if ( window == NULL ) {
-        std::cerr << "failed to create glfw window" << std::endl;
-        glfwTerminate();
-
+int main( int argc, char** argv ) {
+    Options options;
+    if ( !parse_options( argc, argv, options ) ) {
         return -1;
     }
 
-    // set context
-    glfwMakeContextCurrent( window );
+    GLFWwindow* window = NULL;
+    HeadlessContext headless_context;
+    GLADloadproc gl_loader;
+
+    if ( options.headless ) {
+        #pragma region egl setup
+
+        // no window, just a context we can render offscreen with
+        if ( !headless_context.create( WINDOW_WIDTH, WINDOW_HEIGHT, options.gl_debug ) ) {
+            std::cerr << "failed to create headless context" << std::endl;
+
+            return -1;
+        }
+
+        gl_loader = (GLADloadproc) HeadlessContext::get_proc_address;
+
+        #pragma endregion
+    } else {
+        #pragma region glfw setup
+
+        // init glfw and some settings
+        glfwInit();
+        glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
+        glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 3 );
+        glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+        glfwWindowHint( GLFW_OPENGL_DEBUG_CONTEXT, options.gl_debug );
+
+        // create window object
+        window = glfwCreateWindow(
+            WINDOW_WIDTH,
+            WINDOW_HEIGHT,
+            "compute shader test",
+            NULL,
+            NULL );
+
+        // ensure creation was successful 
+        if ( window == NULL ) {
+            std::cerr << "failed to create glfw window" << std::endl;
+            glfwTerminate();
+
+            return -1;
+        }
+
+        // set context
+        glfwMakeContextCurrent( window );
+        set_swap_interval( options.vsync );
+
+        gl_loader = (GLADloadproc) glfwGetProcAddress;
+
+        #pragma endregion
+    }
 
     // load glad before we make any opengl calls
-    if ( !gladLoadGLLoader( (GLADloadproc) glfwGetProcAddress ) ) {
+    if ( !gladLoadGLLoader( gl_loader ) ) {
         std::cerr << "failed to initialise glad" << std::endl;
 
         return -1;
@@ -37,18 +67,33 @@ int main() {
 
     // set gl viewport size, and set glfw callback for window resize
     glViewport( 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT );
-    glfwSetFramebufferSizeCallback( window, framebuffer_size_callback );
+    if ( window != NULL ) {
+        glfwSetFramebufferSizeCallback( window, framebuffer_size_callback );
+    }
 
-    #if DEBUG_ACTIVE
-    glEnable( GL_DEBUG_OUTPUT );
-    glDebugMessageCallback( gl_message_callback, 0 );
-    #endif
+    GLDebug gl_debug;
+    if ( options.gl_debug ) {
+        gl_debug.min_severity = options.gl_debug_severity;
+        gl_debug.start();
+    }
 
-    #pragma endregion
+    if ( options.bench != NULL ) {
+        int failures = run_benchmark( options.bench, options.bench_size );
+        gl_debug.stop();
+        if ( options.gl_debug ) {
+            gl_debug.print_summary( std::cout );
+        }
+        if ( window != NULL ) {
+            glfwTerminate();
+        }
+
+        // a failure count could wrap to 0 as an exit status
+        return failures == 0 ? 0 : 1;
+    }
 
     #pragma region compute shader setup
 
-    Compute compute_shader( "shader.comp", glm::uvec2( 10, 1 ) );
+    Compute compute_shader( "shader.comp", glm::uvec2( 10, 1 ), true );
 
     compute_shader.use();
     float values[ 10 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
@@ -61,53 +106,196 @@ int main() {
     Shader visual_shader( "shader.vert", "shader.frag" );
     BatchRenderer renderer;
 
+    // there is no default framebuffer to draw to without a window, and
+    // capturing reads back from our own framebuffer either way
+    std::unique_ptr<Framebuffer> offscreen;
+    if ( options.headless || options.capture_path != NULL ) {
+        offscreen.reset( new Framebuffer( WINDOW_WIDTH, WINDOW_HEIGHT ) );
+        renderer.set_target( offscreen.get() );
+    }
+
+    std::unique_ptr<FrameCapture> capture;
+    if ( options.capture_path != NULL ) {
+        capture.reset( new FrameCapture( options.capture_path, WINDOW_WIDTH, WINDOW_HEIGHT, options.capture_fps ) );
+    }
+
     #pragma endregion
 
     #pragma region render loop
 
-    while ( !glfwWindowShouldClose( window ) ) {
+    auto last_time = std::chrono::steady_clock::now();
+    unsigned int frame = 0;
+    FrameTimer frame_timer( options.frames );
+
+    // simulation runs on its own clock, rendering blends the newest state
+    // with the one a single step before it
+    FixedTimestep timestep( options.sim_rate, options.max_steps );
+    compute_shader.use();
+    std::vector<float> previous_values = compute_shader.get_values();
+    std::vector<float> current_values = previous_values;
+    std::vector<float> render_values( current_values.size() );
+
+    // printing every value synchronously would dominate the frame
+    AsyncLogger logger( options.log_mode, options.log_path );
+    logger.every = options.log_every;
+    logger.stride = options.log_stride;
+
+    ComputeGraph graph;
+    std::vector<StepParams> step_params( options.max_steps );
+
+    Profiler profiler( options.trace_path != NULL );
+    PipelineStats stats( options.pipeline_stats, &profiler );
+
+    while ( !should_close( window, options, frame ) ) {
+        frame_timer.tick();
+        profiler.begin_frame();
+        stats.begin_frame();
+
+        auto now = std::chrono::steady_clock::now();
+        double frame_seconds = std::chrono::duration<double>( now - last_time ).count();
+        last_time = now;
+
+        // recording without a window is offline, every frame is exactly
+        // one video frame whatever it took to render
+        if ( options.headless && capture ) {
+            frame_seconds = 1.0 / options.capture_fps;
+        }
+
         // input
-        process_input( window );
+        if ( window != NULL ) {
+            ProfileZone zone( profiler, "process_input", false );
+            process_input( window );
+        }
 
-        // update
-        compute_shader.use();
-        compute_shader.dispatch();
-        compute_shader.wait();
+        // update, steps are back to back on the gpu and only the last two
+        // states are read
+        unsigned int steps = timestep.advance( frame_seconds );
+        if ( steps > 0 ) {
+            {
+                ProfileZone zone( profiler, "dispatch" );
+                stats.begin( StatsPass::COMPUTE );
+
+                // all of this frame's steps go in one batch, which puts
+                // image barriers between them. the graph adds the texture
+                // update barrier before the readbacks
+                for ( unsigned int i = 0; i < steps; i++ ) {
+                    unsigned int index = (unsigned int) ( timestep.step_count - steps + i );
+                    step_params[ i ] = { (float) ( index * timestep.step ), (float) timestep.step, index, 0 };
+                }
+
+                graph.reset();
+                ComputeGraph::Resource state[ 2 ] = {
+                    graph.import_image( "compute state", compute_shader.out_tex.get() ),
+                    graph.import_image( "compute back state", compute_shader.back_tex.get() ),
+                };
+                graph.add_pass( "steps", [ & ] { compute_shader.submit_steps( step_params.data(), steps ); } )
+                    .read( state[ 0 ], Access::IMAGE )
+                    .write( state[ 0 ], Access::IMAGE )
+                    .write( state[ 1 ], Access::IMAGE );
+                graph.output( state[ steps % 2 ], Access::TRANSFER );
+                graph.output( state[ ( steps + 1 ) % 2 ], Access::TRANSFER );
+                graph.execute();
+
+                stats.end( StatsPass::COMPUTE );
+            }
+
+            // several steps may have run, so the state this frame started
+            // with can be more than one step old. blend from the input of
+            // the last step instead, which swap() left in the back buffer
+            ProfileZone zone( profiler, "get_values" );
+            previous_values = compute_shader.get_previous_values();
+            current_values = compute_shader.get_values();
+        }
 
-        auto data = compute_shader.get_values();
-        for ( auto d : data ) {
-            std::cout << d << " ";
+        float alpha = timestep.alpha();
+        for ( size_t i = 0; i < render_values.size(); i++ ) {
+            render_values[ i ] = lerp( previous_values[ i ], current_values[ i ], alpha );
         }
-        std::cout << std::endl;
+
+        logger.log_values( frame, render_values.data(), render_values.size() );
 
         // draw
-        renderer.clear( glm::vec3( 0.1f, 0.1f, 0.1f ) );
-
-        auto x_offset = glm::sin( glfwGetTime() * 2 ) * 0.2;
-        renderer.add_square(
-            glm::vec2( 0.0f + x_offset, 0.0f ),
-            glm::uvec3( 255, 0, 0 ),
-            0.1f );
-        renderer.add_square(
-            glm::vec2( 0.0f + x_offset, 0.5f ),
-            glm::uvec3( 0, 255, 0 ),
-            0.1f );
-        renderer.add_square(
-            glm::vec2( 0.0f + x_offset, -0.5f ),
-            glm::uvec3( 0, 0, 255 ),
-            0.1f );
-
-        renderer.render( &visual_shader );
+        {
+            ProfileZone render_zone( profiler, "render" );
+            renderer.clear( glm::vec3( 0.1f, 0.1f, 0.1f ) );
+
+            // animate on simulation time so motion matches the compute state
+            double time = timestep.interpolated_time();
+            auto x_offset = glm::sin( time * 2 ) * 0.2;
+            renderer.add_square(
+                glm::vec2( 0.0f + x_offset, 0.0f ),
+                glm::uvec3( 255, 0, 0 ),
+                0.1f );
+            renderer.add_square(
+                glm::vec2( 0.0f + x_offset, 0.5f ),
+                glm::uvec3( 0, 255, 0 ),
+                0.1f );
+            renderer.add_square(
+                glm::vec2( 0.0f + x_offset, -0.5f ),
+                glm::uvec3( 0, 0, 255 ),
+                0.1f );
+
+            stats.begin( StatsPass::DRAW );
+            renderer.render( &visual_shader );
+            stats.end( StatsPass::DRAW );
+        }
+
+        if ( capture ) {
+            ProfileZone zone( profiler, "capture" );
+            capture->capture( offscreen.get(), timestep.interpolated_time() );
+        }
+
+        // show the offscreen frame in the window
+        if ( window != NULL && offscreen ) {
+            int width, height;
+            glfwGetFramebufferSize( window, &width, &height );
+            offscreen->blit_to_default( width, height );
+        }
 
         // poll glfw events and swap buffers
-        glfwPollEvents();
-        glfwSwapBuffers( window );
+        {
+            ProfileZone zone( profiler, "swap" );
+            if ( window != NULL ) {
+                glfwPollEvents();
+                glfwSwapBuffers( window );
+            } else {
+                glFlush();
+            }
+        }
+
+        profiler.end_frame();
+        stats.end_frame();
+        frame++;
+    }
+
+    frame_timer.stop();
+    logger.stop();
+    frame_timer.print_summary( std::cout );
+    timestep.print_summary( std::cout );
+    stats.print_summary( std::cout );
+    graph.print_summary( std::cout );
+    gl_state().print_summary( std::cout );
+    gpu_memory().print_summary( std::cout );
+    if ( options.gl_debug ) {
+        gl_debug.print_summary( std::cout );
+    }
+    if ( options.trace_path != NULL ) {
+        profiler.write_chrome_trace( options.trace_path );
     }
 
     #pragma endregion
 
+    // drain the capture while the context is still around
+    if ( capture ) {
+        capture->finish();
+    }
+
+    gl_debug.stop();
+
     // clean up resources upon successful exit
-    glfwTerminate();
+    if ( window != NULL ) {
+        glfwTerminate();
+    }
 
     return 0;
 }
@@ -117,123 +305,41 @@ void framebuffer_size_callback( GLFWwindow* window, int width, int height ) {
     glViewport( 0, 0, width, height );
 }
 
-// handle all input here
-void process_input( GLFWwindow* window ) {
-    // close window on pressing esc
-    if ( glfwGetKey( window, GLFW_KEY_ESCAPE ) == GLFW_PRESS ) {
-        glfwSetWindowShouldClose( window, true );
-    }
-}
-
-#if DEBUG_ACTIVE
-// more information at https://www.khronos.org/opengl/wiki/Debug_Output
-void GLAPIENTRY gl_message_callback( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param ) {
-    // parse source
-    std::string source_name;
-    switch ( source ) {
-        case GL_DEBUG_SOURCE_API:
-            source_name = "GL_DEBUG_SOURCE_API";
-            break;
-
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
-            source_name = "GL_DEBUG_SOURCE_WINDOW_SYSTEM";
-            break;
-
-        case GL_DEBUG_SOURCE_SHADER_COMPILER:
-            source_name = "GL_DEBUG_SOURCE_SHADER_COMPILER";
-            break;
-
-        case GL_DEBUG_SOURCE_THIRD_PARTY:
-            source_name = "GL_DEBUG_SOURCE_THIRD_PARTY";
-            break;
-
-        case GL_DEBUG_SOURCE_APPLICATION:
-            source_name = "GL_DEBUG_SOURCE_APPLICATION";
+// picks the glfw swap interval, adaptive needs the swap_control_tear extension
+void set_swap_interval( VsyncMode mode ) {
+    switch ( mode ) {
+        case VsyncMode::OFF:
+            glfwSwapInterval( 0 );
             break;
 
-        case GL_DEBUG_SOURCE_OTHER:
-            source_name = "GL_DEBUG_SOURCE_OTHER";
+        case VsyncMode::ON:
+            glfwSwapInterval( 1 );
             break;
 
-        default:
-            source_name = "UNKNOWN";
+        case VsyncMode::ADAPTIVE:
+            if ( glfwExtensionSupported( "GLX_EXT_swap_control_tear" ) || glfwExtensionSupported( "WGL_EXT_swap_control_tear" ) ) {
+                glfwSwapInterval( -1 );
+            } else {
+                std::cerr << "adaptive vsync not supported, using vsync on" << std::endl;
+                glfwSwapInterval( 1 );
+            }
             break;
     }
+}
 
-    // parse type
-    std::string type_name;
-    switch ( type ) {
-        case GL_DEBUG_TYPE_ERROR:
-            type_name = "GL_DEBUG_TYPE_ERROR";
-            break;
-
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
-            type_name = "GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR";
-            break;
-
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
-            type_name = "GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR";
-            break;
-
-        case GL_DEBUG_TYPE_PORTABILITY:
-            type_name = "GL_DEBUG_TYPE_PORTABILITY";
-            break;
-
-        case GL_DEBUG_TYPE_PERFORMANCE:
-            type_name = "GL_DEBUG_TYPE_PERFORMANCE";
-            break;
-
-        case GL_DEBUG_TYPE_MARKER:
-            type_name = "GL_DEBUG_TYPE_MARKER";
-            break;
-
-        case GL_DEBUG_TYPE_PUSH_GROUP:
-            type_name = "GL_DEBUG_TYPE_PUSH_GROUP";
-            break;
-
-        case GL_DEBUG_TYPE_POP_GROUP:
-            type_name = "GL_DEBUG_TYPE_POP_GROUP";
-            break;
-
-        case GL_DEBUG_TYPE_OTHER:
-            type_name = "GL_DEBUG_TYPE_OTHER";
-            break;
-
-        default:
-            type_name = "UNKNOWN";
-            break;
+// true once the window is closed or the requested frame count has run
+bool should_close( GLFWwindow* window, const Options& options, unsigned int frame ) {
+    if ( options.frames > 0 && frame >= options.frames ) {
+        return true;
     }
 
-    // parse severity
-    std::string severity_name;
-    switch ( severity ) {
-        case GL_DEBUG_SEVERITY_HIGH:
-            severity_name = "GL_DEBUG_SEVERITY_HIGH";
-            break;
-
-        case GL_DEBUG_SEVERITY_MEDIUM:
-            severity_name = "GL_DEBUG_SEVERITY_MEDIUM";
-            break;
-
-        case GL_DEBUG_SEVERITY_LOW:
-            severity_name = "GL_DEBUG_SEVERITY_LOW";
-            break;
-
-        case GL_DEBUG_SEVERITY_NOTIFICATION:
-            severity_name = "GL_DEBUG_SEVERITY_NOTIFICATION";
-            break;
+    return window != NULL && glfwWindowShouldClose( window );
+}
 
-        default:
-            severity_name = "UNKNOWN";
-            break;
+// handle all input here
+void process_input( GLFWwindow* window ) {
+    // close window on pressing esc
+    if ( glfwGetKey( window, GLFW_KEY_ESCAPE ) == GLFW_PRESS ) {
+        glfwSetWindowShouldClose( window, true );
     }
-
-    // print message
-    std::cerr << "GL CALLBACK:\n";
-    std::cerr << "source: " << source_name << "\n";
-    std::cerr << "type: " << type_name << "\n";
-    std::cerr << "severity: " << severity_name << "\n";
-    std::cerr << "message: " << message << "\n";
-    std::cerr << std::endl;
 }
-#endif
@@ -3,10 +3,11 @@
 
 #define WINDOW_WIDTH 500
 #define WINDOW_HEIGHT 500
-#define DEBUG_ACTIVE false
 
 #include <iostream>
 #include <cmath>
+#include <chrono>
+#include <memory>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -14,12 +15,33 @@
 #include "shader.h"
 #include "compute.h"
 #include "batch_renderer.h"
+#include "framebuffer.h"
+#include "frame_capture.h"
+#include "frame_timer.h"
+#include "fixed_timestep.h"
+#include "async_logger.h"
+#include "profiler.h"
+#include "pipeline_stats.h"
+#include "gl_debug.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "gl_handle.h"
+#include "compute_program.h"
+#include "storage_buffer.h"
+#include "reduce.h"
+#include "scan.h"
+#include "radix_sort.h"
+#include "compaction.h"
+#include "compute_graph.h"
+#include "stream_executor.h"
+#include "mapped_file.h"
+#include "benchmarks.h"
+#include "headless.h"
+#include "options.h"
 
 void framebuffer_size_callback( GLFWwindow* window, int width, int height );
+void set_swap_interval( VsyncMode mode );
+bool should_close( GLFWwindow* window, const Options& options, unsigned int frame );
 void process_input( GLFWwindow* window );
 
-#if DEBUG_ACTIVE
-void GLAPIENTRY gl_message_callback( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param );
-#endif
-
 #endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include "stream_executor.h"
+
+// a whole file mapped into memory, so compute jobs can upload straight
+// from it and write results straight into it without a copy through a
+// std::vector on either side. move only
+class MappedFile {
+public:
+    MappedFile() {
+        fd = -1;
+        data = NULL;
+        bytes = 0;
+    }
+
+    MappedFile( MappedFile&& other ) {
+        fd = other.fd;
+        data = other.data;
+        bytes = other.bytes;
+        other.fd = -1;
+        other.data = NULL;
+        other.bytes = 0;
+    }
+
+    // unmaps and closes whatever this held first
+    MappedFile& operator=( MappedFile&& other ) {
+        if ( this != &other ) {
+            close();
+            fd = other.fd;
+            data = other.data;
+            bytes = other.bytes;
+            other.fd = -1;
+            other.data = NULL;
+            other.bytes = 0;
+        }
+        return *this;
+    }
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // map an existing file read only
+    bool open_read( const char* path ) {
+        close();
+
+        fd = open( path, O_RDONLY );
+        struct stat info;
+        if ( fd < 0 || fstat( fd, &info ) != 0 ) {
+            std::cerr << "mapped file: can't open " << path << ": " << strerror( errno ) << std::endl;
+            close();
+            return false;
+        }
+
+        return map( path, (size_t) info.st_size, PROT_READ, MADV_SEQUENTIAL );
+    }
+
+    // create or truncate a file of size bytes and map it for writing
+    bool create( const char* path, size_t size ) {
+        close();
+
+        fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        if ( fd < 0 || ftruncate( fd, (off_t) size ) != 0 ) {
+            std::cerr << "mapped file: can't create " << path << ": " << strerror( errno ) << std::endl;
+            close();
+            return false;
+        }
+
+        return map( path, size, PROT_READ | PROT_WRITE, MADV_SEQUENTIAL );
+    }
+
+    void close() {
+        if ( data != NULL ) {
+            munmap( data, bytes );
+        }
+        if ( fd >= 0 ) {
+            ::close( fd );
+        }
+
+        fd = -1;
+        data = NULL;
+        bytes = 0;
+    }
+
+    template <typename T>
+    T* as() {
+        return (T*) data;
+    }
+
+    size_t size() {
+        return bytes;
+    }
+
+private:
+    int fd;
+    void* data;
+    size_t bytes;
+
+    bool map( const char* path, size_t size, int protection, int advice ) {
+        bytes = size;
+
+        // mmap refuses empty mappings, an empty file just has no data
+        if ( size == 0 ) {
+            return true;
+        }
+
+        data = mmap( NULL, size, protection, MAP_SHARED, fd, 0 );
+        if ( data == MAP_FAILED ) {
+            std::cerr << "mapped file: can't map " << path << ": " << strerror( errno ) << std::endl;
+            data = NULL;
+            close();
+            return false;
+        }
+
+        // the data is read once front to back, so let the kernel read ahead
+        madvise( data, size, advice );
+        return true;
+    }
+};
+
+// run a streaming job from one file of raw floats to another of the same
+// size. chunks are uploaded from the input mapping and the executor's
+// mapped pack buffers copy results straight into the output mapping. an
+// input that isn't a whole number of floats is rejected, nothing written
+bool stream_file( StreamExecutor& executor, const char* input_path, const char* output_path ) {
+    MappedFile input;
+    if ( !input.open_read( input_path ) ) {
+        return false;
+    }
+
+    if ( input.size() % sizeof(float) != 0 ) {
+        std::cerr << "mapped file: " << input_path << " is " << input.size() << " bytes, not a whole number of floats"
+            << std::endl;
+        return false;
+    }
+
+    MappedFile output;
+    if ( !output.create( output_path, input.size() ) ) {
+        return false;
+    }
+
+    size_t count = input.size() / sizeof(float);
+    if ( count > 0 ) {
+        executor.run( input.as<float>(), output.as<float>(), count );
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "async_logger.h"
+
+enum class VsyncMode {
+    OFF,
+    ON,
+    // sync when on time, tear instead of waiting a whole interval when late
+    ADAPTIVE,
+};
+
+// runtime options, parsed from the command line
+struct Options {
+    // run without a window, rendering into an offscreen framebuffer
+    bool headless = false;
+    // stop after this many frames, 0 runs until the window is closed
+    unsigned int frames = 0;
+    // record rendered frames to this file (.y4m or a ppm stream), NULL for none
+    const char* capture_path = NULL;
+    // frame rate of the recording, frames are skipped or repeated to match
+    unsigned int capture_fps = 60;
+    // swap interval for the window, ignored when headless
+    VsyncMode vsync = VsyncMode::ON;
+    // compute steps per second of simulated time, independent of frame rate
+    double sim_rate = 60.0;
+    // cap on compute steps run in one frame when we fall behind
+    unsigned int max_steps = 8;
+    // how compute values are logged each frame, and where (NULL for stdout)
+    LogMode log_mode = LogMode::TEXT;
+    const char* log_path = NULL;
+    // log every nth frame, and every nth value within it
+    unsigned int log_every = 1;
+    unsigned int log_stride = 1;
+    // write a chrome trace of cpu and gpu zones here on exit, NULL for none
+    const char* trace_path = NULL;
+    // count shader invocations and primitives for the compute and draw passes
+    bool pipeline_stats = false;
+    // gl debug output, and the least severe messages to let through
+    bool gl_debug = false;
+    GLenum gl_debug_severity = GL_DEBUG_SEVERITY_LOW;
+    // run this gpu primitive benchmark instead of the render loop
+    const char* bench = NULL;
+    size_t bench_size = 1 << 24;
+};
+
+void print_usage( const char* program ) {
+    std::cerr << "usage: " << program << " [options]\n";
+    std::cerr << "  --headless     run without a window (egl, offscreen framebuffer)\n";
+    std::cerr << "  --frames <n>   exit after n frames (headless defaults to 1)\n";
+    std::cerr << "  --capture <file> record frames to a .y4m video or a ppm stream\n";
+    std::cerr << "  --capture-fps <n> frame rate of the recording (default 60)\n";
+    std::cerr << "  --vsync <mode>   off, on or adaptive (default on)\n";
+    std::cerr << "  --sim-rate <hz>  simulation steps per second (default 60)\n";
+    std::cerr << "  --max-steps <n>  most simulation steps per frame (default 8)\n";
+    std::cerr << "  --log <mode>     compute value logging: off, text or binary (default text)\n";
+    std::cerr << "  --log-file <f>   write the log to a file instead of stdout\n";
+    std::cerr << "  --log-every <n>  only log every nth frame\n";
+    std::cerr << "  --log-stride <n> only log every nth value\n";
+    std::cerr << "  --trace <file>   write a chrome trace-event json of frame zones\n";
+    std::cerr << "  --stats          pipeline statistics for compute and draw passes\n";
+    std::cerr << "  --gl-debug <min> gl debug output down to high, medium, low or notification\n";
+    std::cerr << "  --bench <name>   run a benchmark and exit: reduce, scan, sort, compact, graph,\n"
+        "                   timestep, steps, formats, bindings, volume, resize, stream, mmap,\n"
+        "                   or all of them. exits non-zero if any check fails\n";
+    std::cerr << "  --bench-size <n> elements per benchmark run (default 16m)\n";
+    std::cerr << std::endl;
+}
+
+// returns false if the arguments could not be parsed
+bool parse_options( int argc, char** argv, Options& options ) {
+    for ( int i = 1; i < argc; i++ ) {
+        const char* arg = argv[ i ];
+        bool has_value = i + 1 < argc;
+
+        if ( strcmp( arg, "--headless" ) == 0 ) {
+            options.headless = true;
+        } else if ( strcmp( arg, "--frames" ) == 0 && has_value ) {
+            options.frames = strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( strcmp( arg, "--capture" ) == 0 && has_value ) {
+            options.capture_path = argv[ ++i ];
+        } else if ( strcmp( arg, "--capture-fps" ) == 0 && has_value ) {
+            options.capture_fps = strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( strcmp( arg, "--vsync" ) == 0 && has_value ) {
+            const char* mode = argv[ ++i ];
+            if ( strcmp( mode, "off" ) == 0 ) {
+                options.vsync = VsyncMode::OFF;
+            } else if ( strcmp( mode, "on" ) == 0 ) {
+                options.vsync = VsyncMode::ON;
+            } else if ( strcmp( mode, "adaptive" ) == 0 ) {
+                options.vsync = VsyncMode::ADAPTIVE;
+            } else {
+                std::cerr << "unknown vsync mode: " << mode << std::endl;
+                print_usage( argv[ 0 ] );
+                return false;
+            }
+        } else if ( strcmp( arg, "--sim-rate" ) == 0 && has_value ) {
+            options.sim_rate = strtod( argv[ ++i ], NULL );
+        } else if ( strcmp( arg, "--max-steps" ) == 0 && has_value ) {
+            options.max_steps = strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( strcmp( arg, "--log" ) == 0 && has_value ) {
+            const char* mode = argv[ ++i ];
+            if ( strcmp( mode, "off" ) == 0 ) {
+                options.log_mode = LogMode::OFF;
+            } else if ( strcmp( mode, "text" ) == 0 ) {
+                options.log_mode = LogMode::TEXT;
+            } else if ( strcmp( mode, "binary" ) == 0 ) {
+                options.log_mode = LogMode::BINARY;
+            } else {
+                std::cerr << "unknown log mode: " << mode << std::endl;
+                print_usage( argv[ 0 ] );
+                return false;
+            }
+        } else if ( strcmp( arg, "--log-file" ) == 0 && has_value ) {
+            options.log_path = argv[ ++i ];
+        } else if ( strcmp( arg, "--log-every" ) == 0 && has_value ) {
+            options.log_every = strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( strcmp( arg, "--log-stride" ) == 0 && has_value ) {
+            options.log_stride = strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( strcmp( arg, "--trace" ) == 0 && has_value ) {
+            options.trace_path = argv[ ++i ];
+        } else if ( strcmp( arg, "--stats" ) == 0 ) {
+            options.pipeline_stats = true;
+        } else if ( strcmp( arg, "--gl-debug" ) == 0 && has_value ) {
+            const char* severity = argv[ ++i ];
+            options.gl_debug = true;
+            if ( strcmp( severity, "high" ) == 0 ) {
+                options.gl_debug_severity = GL_DEBUG_SEVERITY_HIGH;
+            } else if ( strcmp( severity, "medium" ) == 0 ) {
+                options.gl_debug_severity = GL_DEBUG_SEVERITY_MEDIUM;
+            } else if ( strcmp( severity, "low" ) == 0 ) {
+                options.gl_debug_severity = GL_DEBUG_SEVERITY_LOW;
+            } else if ( strcmp( severity, "notification" ) == 0 ) {
+                options.gl_debug_severity = GL_DEBUG_SEVERITY_NOTIFICATION;
+            } else {
+                std::cerr << "unknown gl debug severity: " << severity << std::endl;
+                print_usage( argv[ 0 ] );
+                return false;
+            }
+        } else if ( strcmp( arg, "--bench" ) == 0 && has_value ) {
+            options.bench = argv[ ++i ];
+        } else if ( strcmp( arg, "--bench-size" ) == 0 && has_value ) {
+            options.bench_size = strtoull( argv[ ++i ], NULL, 10 );
+        } else {
+            std::cerr << "unknown or incomplete option: " << arg << std::endl;
+            print_usage( argv[ 0 ] );
+            return false;
+        }
+    }
+
+    if ( options.sim_rate <= 0.0 || options.max_steps == 0 ) {
+        std::cerr << "--sim-rate and --max-steps must be positive" << std::endl;
+        return false;
+    }
+
+    if ( options.capture_fps == 0 ) {
+        std::cerr << "--capture-fps must be positive" << std::endl;
+        return false;
+    }
+
+    if ( options.log_every == 0 || options.log_stride == 0 ) {
+        std::cerr << "--log-every and --log-stride must be positive" << std::endl;
+        return false;
+    }
+
+    // without a window there is nothing to close, so never run forever by accident
+    if ( options.headless && options.frames == 0 ) {
+        options.frames = 1;
+    }
+
+    return true;
+}
+
+#endif
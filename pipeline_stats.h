@@ -0,0 +1,184 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+
+#include "gl_extensions.h"
+#include "gl_handle.h"
+#include "profiler.h"
+
+enum class StatsPass {
+    COMPUTE,
+    DRAW,
+};
+
+// counts the work the gpu actually did in the compute and draw passes using
+// GL_ARB_pipeline_statistics_query. results are read a few frames late like
+// the profiler's, then sent to the trace as counters and summed for the
+// summary at exit
+class PipelineStats {
+public:
+    bool enabled;
+
+    PipelineStats( bool requested, Profiler* profiler ) {
+        this->profiler = profiler;
+        frame_index = 0;
+        frames_resolved = 0;
+        enabled = requested && has_gl_extension( "GL_ARB_pipeline_statistics_query" );
+
+        for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+            totals[ i ] = 0;
+        }
+
+        if ( requested && !enabled ) {
+            std::cerr << "GL_ARB_pipeline_statistics_query not supported, stats disabled" << std::endl;
+        }
+
+        if ( !enabled ) {
+            return;
+        }
+
+        for ( int i = 0; i < FRAME_LATENCY; i++ ) {
+            frames[ i ].used = false;
+            frames[ i ].ran_compute = false;
+            frames[ i ].ran_draw = false;
+            for ( int counter = 0; counter < COUNTER_COUNT; counter++ ) {
+                queries[ i ][ counter ] = make_query();
+            }
+        }
+    }
+
+    void begin_frame() {
+        if ( !enabled ) {
+            return;
+        }
+
+        // reusing the oldest slot, collect its results first
+        Frame& frame = frames[ frame_index % FRAME_LATENCY ];
+        resolve( frame, frame_index % FRAME_LATENCY );
+
+        frame.used = true;
+        frame.ran_compute = false;
+        frame.ran_draw = false;
+        frame.timestamp = profiler->now();
+    }
+
+    void end_frame() {
+        if ( enabled ) {
+            frame_index++;
+        }
+    }
+
+    // each pass may only run once per frame
+    void begin( StatsPass pass ) {
+        if ( !enabled ) {
+            return;
+        }
+
+        int slot = frame_index % FRAME_LATENCY;
+        for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+            if ( COUNTERS[ i ].pass == pass ) {
+                glBeginQuery( COUNTERS[ i ].target, queries[ slot ][ i ].get() );
+            }
+        }
+
+        if ( pass == StatsPass::COMPUTE ) {
+            frames[ slot ].ran_compute = true;
+        } else {
+            frames[ slot ].ran_draw = true;
+        }
+    }
+
+    void end( StatsPass pass ) {
+        if ( !enabled ) {
+            return;
+        }
+
+        for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+            if ( COUNTERS[ i ].pass == pass ) {
+                glEndQuery( COUNTERS[ i ].target );
+            }
+        }
+    }
+
+    // collects the frames still in flight and prints per frame averages
+    void print_summary( std::ostream& out ) {
+        if ( !enabled ) {
+            return;
+        }
+
+        for ( int i = 0; i < FRAME_LATENCY; i++ ) {
+            int slot = ( frame_index + i ) % FRAME_LATENCY;
+            resolve( frames[ slot ], slot );
+        }
+
+        if ( frames_resolved == 0 ) {
+            return;
+        }
+
+        out << "pipeline statistics, per frame average over " << frames_resolved << " frames:\n";
+        for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+            out << "  " << COUNTERS[ i ].name << ": " << totals[ i ] / (double) frames_resolved << "\n";
+        }
+        out << std::flush;
+    }
+
+private:
+    static const int FRAME_LATENCY = 3;
+    static const int COUNTER_COUNT = 6;
+
+    struct Counter {
+        GLenum target;
+        const char* name;
+        StatsPass pass;
+    };
+
+    static constexpr Counter COUNTERS[ COUNTER_COUNT ] = {
+        { GL_COMPUTE_SHADER_INVOCATIONS_ARB, "compute shader invocations", StatsPass::COMPUTE },
+        { GL_VERTICES_SUBMITTED_ARB, "vertices submitted", StatsPass::DRAW },
+        { GL_PRIMITIVES_SUBMITTED_ARB, "primitives submitted", StatsPass::DRAW },
+        { GL_VERTEX_SHADER_INVOCATIONS_ARB, "vertex shader invocations", StatsPass::DRAW },
+        { GL_CLIPPING_OUTPUT_PRIMITIVES_ARB, "primitives after clipping", StatsPass::DRAW },
+        { GL_FRAGMENT_SHADER_INVOCATIONS_ARB, "fragment shader invocations", StatsPass::DRAW },
+    };
+
+    struct Frame {
+        bool used;
+        bool ran_compute, ran_draw;
+        int64_t timestamp;
+    };
+
+    Profiler* profiler;
+    Frame frames[ FRAME_LATENCY ];
+    QueryHandle queries[ FRAME_LATENCY ][ COUNTER_COUNT ];
+    unsigned int frame_index;
+    unsigned int frames_resolved;
+    uint64_t totals[ COUNTER_COUNT ];
+
+    void resolve( Frame& frame, int slot ) {
+        if ( !frame.used ) {
+            return;
+        }
+
+        for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+            bool ran = COUNTERS[ i ].pass == StatsPass::COMPUTE ? frame.ran_compute : frame.ran_draw;
+
+            // a pass that didn't run this frame (no compute step due) did no work
+            GLuint64 value = 0;
+            if ( ran ) {
+                glGetQueryObjectui64v( queries[ slot ][ i ].get(), GL_QUERY_RESULT, &value );
+            }
+
+            totals[ i ] += value;
+            profiler->add_counter( COUNTERS[ i ].name, frame.timestamp, value );
+        }
+
+        frames_resolved++;
+        frame.used = false;
+    }
+};
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "gl_handle.h"
+
+// cpu and gpu timing zones, exported as chrome trace events (load the file
+// in chrome://tracing or ui.perfetto.dev). gpu times come from timestamp
+// queries that are read back a few frames later so we never wait on the gpu.
+// everything is allocated up front, recording a frame doesn't allocate
+class Profiler {
+public:
+    bool enabled;
+
+    // max_events bounds the whole trace, zones past it are counted and dropped
+    Profiler( bool enabled, size_t max_events = 1 << 18 ) {
+        this->enabled = enabled;
+        frame_index = 0;
+        zone_count = 0;
+        dropped = 0;
+
+        if ( !enabled ) {
+            return;
+        }
+
+        events.reserve( max_events );
+        for ( int i = 0; i < FRAME_LATENCY; i++ ) {
+            frames[ i ].zone_count = 0;
+            for ( int zone = 0; zone < MAX_ZONES; zone++ ) {
+                queries[ i ][ zone ][ 0 ] = make_query();
+                queries[ i ][ zone ][ 1 ] = make_query();
+            }
+        }
+
+        // line the gpu clock up with ours, both are in nanoseconds
+        epoch = std::chrono::steady_clock::now();
+        GLint64 gpu_now;
+        glGetInteger64v( GL_TIMESTAMP, &gpu_now );
+        gpu_offset = gpu_now - cpu_now();
+    }
+
+    void begin_frame() {
+        if ( !enabled ) {
+            return;
+        }
+
+        // the slot we're about to reuse was recorded FRAME_LATENCY frames ago
+        resolve( frames[ frame_index % FRAME_LATENCY ], frame_index % FRAME_LATENCY );
+        zone_count = 0;
+    }
+
+    void end_frame() {
+        if ( !enabled ) {
+            return;
+        }
+
+        frames[ frame_index % FRAME_LATENCY ].zone_count = zone_count;
+        frame_index++;
+    }
+
+    // returns a zone handle for end_zone, or -1 if the frame is full
+    int begin_zone( const char* name, bool gpu ) {
+        if ( !enabled || zone_count == MAX_ZONES ) {
+            return -1;
+        }
+
+        int zone = zone_count++;
+        int slot = frame_index % FRAME_LATENCY;
+        Zone& z = frames[ slot ].zones[ zone ];
+        z.name = name;
+        z.gpu = gpu;
+        z.cpu_begin = cpu_now();
+        if ( gpu ) {
+            glQueryCounter( queries[ slot ][ zone ][ 0 ].get(), GL_TIMESTAMP );
+        }
+
+        return zone;
+    }
+
+    void end_zone( int zone ) {
+        if ( zone < 0 ) {
+            return;
+        }
+
+        int slot = frame_index % FRAME_LATENCY;
+        Zone& z = frames[ slot ].zones[ zone ];
+        z.cpu_end = cpu_now();
+        if ( z.gpu ) {
+            glQueryCounter( queries[ slot ][ zone ][ 1 ].get(), GL_TIMESTAMP );
+        }
+    }
+
+    // nanoseconds since the profiler started, the clock all events use
+    int64_t now() {
+        return cpu_now();
+    }
+
+    // a sample for a counter track, shown as a graph above the zones
+    void add_counter( const char* name, int64_t timestamp, uint64_t value ) {
+        if ( !enabled ) {
+            return;
+        }
+
+        if ( events.size() == events.capacity() ) {
+            dropped++;
+            return;
+        }
+
+        events.push_back( { name, false, timestamp, timestamp, true, value } );
+    }
+
+    // resolves any outstanding frames and writes the trace
+    void write_chrome_trace( const char* path ) {
+        if ( !enabled ) {
+            return;
+        }
+
+        for ( int i = 0; i < FRAME_LATENCY; i++ ) {
+            int slot = ( frame_index + i ) % FRAME_LATENCY;
+            resolve( frames[ slot ], slot );
+        }
+
+        std::ofstream file( path, std::ios::trunc );
+        if ( !file.is_open() ) {
+            std::cerr << "failed to open trace file " << path << std::endl;
+            return;
+        }
+
+        // default stream precision turns long runs into 1.2e+06 style stamps
+        file << std::fixed << std::setprecision( 3 );
+        file << "{\"traceEvents\":[\n";
+        file << "{\"ph\":\"M\",\"pid\":1,\"tid\":1,\"name\":\"thread_name\",\"args\":{\"name\":\"cpu\"}},\n";
+        file << "{\"ph\":\"M\",\"pid\":1,\"tid\":2,\"name\":\"thread_name\",\"args\":{\"name\":\"gpu\"}}";
+        for ( auto& e : events ) {
+            if ( e.counter ) {
+                file << ",\n{\"ph\":\"C\",\"pid\":1,\"name\":\"" << e.name << "\"";
+                file << ",\"ts\":" << e.begin / 1000.0;
+                file << ",\"args\":{\"value\":" << e.value << "}}";
+                continue;
+            }
+
+            // chrome wants microseconds
+            file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << ( e.gpu ? 2 : 1 );
+            file << ",\"name\":\"" << e.name << "\"";
+            file << ",\"ts\":" << e.begin / 1000.0;
+            file << ",\"dur\":" << ( e.end - e.begin ) / 1000.0 << "}";
+        }
+        file << "\n]}\n";
+
+        std::cout << "wrote " << events.size() << " trace events to " << path;
+        if ( dropped > 0 ) {
+            std::cout << " (" << dropped << " dropped, trace buffer full)";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    static const int FRAME_LATENCY = 3;
+    static const int MAX_ZONES = 32;
+
+    struct Zone {
+        const char* name;
+        bool gpu;
+        int64_t cpu_begin, cpu_end;
+    };
+
+    struct Frame {
+        Zone zones[ MAX_ZONES ];
+        int zone_count;
+    };
+
+    struct Event {
+        const char* name;
+        bool gpu;
+        int64_t begin, end;
+        // counter events only use begin, as the sample time
+        bool counter;
+        uint64_t value;
+    };
+
+    Frame frames[ FRAME_LATENCY ];
+    QueryHandle queries[ FRAME_LATENCY ][ MAX_ZONES ][ 2 ];
+    unsigned int frame_index;
+    int zone_count;
+
+    std::vector<Event> events;
+    unsigned int dropped;
+
+    std::chrono::steady_clock::time_point epoch;
+    int64_t gpu_offset;
+
+    int64_t cpu_now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - epoch ).count();
+    }
+
+    // turn a recorded frame into trace events. by the time a slot comes
+    // round again its queries are normally long finished
+    void resolve( Frame& frame, int slot ) {
+        for ( int i = 0; i < frame.zone_count; i++ ) {
+            Zone& z = frame.zones[ i ];
+            push_event( z.name, false, z.cpu_begin, z.cpu_end );
+
+            if ( z.gpu ) {
+                GLuint64 gpu_begin, gpu_end;
+                glGetQueryObjectui64v( queries[ slot ][ i ][ 0 ].get(), GL_QUERY_RESULT, &gpu_begin );
+                glGetQueryObjectui64v( queries[ slot ][ i ][ 1 ].get(), GL_QUERY_RESULT, &gpu_end );
+                push_event( z.name, true, (int64_t) gpu_begin - gpu_offset, (int64_t) gpu_end - gpu_offset );
+            }
+        }
+
+        frame.zone_count = 0;
+    }
+
+    void push_event( const char* name, bool gpu, int64_t begin, int64_t end ) {
+        if ( events.size() == events.capacity() ) {
+            dropped++;
+            return;
+        }
+
+        events.push_back( { name, gpu, begin, end, false, 0 } );
+    }
+};
+
+// times the enclosing scope on the cpu, and on the gpu when asked
+class ProfileZone {
+public:
+    ProfileZone( Profiler& profiler, const char* name, bool gpu = true ) : profiler( profiler ) {
+        zone = profiler.begin_zone( name, gpu );
+    }
+
+    ~ProfileZone() {
+        profiler.end_zone( zone );
+    }
+
+private:
+    Profiler& profiler;
+    int zone;
+};
+
+#endif
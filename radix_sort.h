@@ -0,0 +1,114 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <glad/glad.h>
+
+#include <utility>
+#include <vector>
+
+#include "compute_program.h"
+#include "scan.h"
+#include "storage_buffer.h"
+
+// lsd radix sort of 32-bit uint keys, optionally carrying a 32-bit value
+// each, entirely on the gpu. eight 4-bit passes of histogram, prefix scan,
+// scatter, ping ponging through scratch buffers, so the sorted result ends
+// up back in the buffers passed in. stable
+class RadixSort {
+public:
+    RadixSort()
+        : histogram_pass( "radix_sort.comp", "#define PASS_HISTOGRAM 1\n" ),
+          scatter_keys( "radix_sort.comp", "#define PASS_SCATTER 1\n" ),
+          scatter_pairs( "radix_sort.comp", "#define PASS_SCATTER 1\n#define KEY_VALUE 1\n" ) {
+    }
+
+    void sort( StorageBuffer& keys, size_t count ) {
+        run( keys, NULL, count );
+    }
+
+    // sorts keys and applies the same permutation to values
+    void sort_pairs( StorageBuffer& keys, StorageBuffer& values, size_t count ) {
+        run( keys, &values, count );
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 256;
+    static const int RADIX = 16;
+    static const int BITS = 4;
+
+    ComputeProgram histogram_pass;
+    ComputeProgram scatter_keys;
+    ComputeProgram scatter_pairs;
+    PrefixScan scan;
+
+    // grown on demand and kept for the next sort
+    std::vector<StorageBuffer> scratch;
+
+    StorageBuffer& scratch_buffer( int index, size_t bytes ) {
+        static const char* labels[] = { "radix sort keys", "radix sort values", "radix sort histogram" };
+
+        while ( (int) scratch.size() <= index ) {
+            scratch.emplace_back( labels[ scratch.size() ], sizeof(unsigned int) );
+        }
+        if ( scratch[ index ].size < bytes ) {
+            scratch[ index ] = StorageBuffer( labels[ index ], bytes );
+        }
+        return scratch[ index ];
+    }
+
+    void run( StorageBuffer& keys, StorageBuffer* values, size_t count ) {
+        if ( count <= 1 ) {
+            return;
+        }
+
+        size_t blocks = ( count + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+        size_t histogram_count = blocks * RADIX;
+
+        // size everything first, growing later would move the vector
+        scratch_buffer( 0, count * sizeof(unsigned int) );
+        scratch_buffer( 1, values != NULL ? count * sizeof(unsigned int) : sizeof(unsigned int) );
+        scratch_buffer( 2, histogram_count * sizeof(unsigned int) );
+
+        StorageBuffer* keys_in = &keys;
+        StorageBuffer* keys_out = &scratch[ 0 ];
+        StorageBuffer* values_in = values != NULL ? values : &scratch[ 1 ];
+        StorageBuffer* values_out = &scratch[ 1 ];
+        StorageBuffer& histogram = scratch[ 2 ];
+
+        ComputeProgram& scatter_pass = values != NULL ? scatter_pairs : scatter_keys;
+
+        for ( unsigned int shift = 0; shift < 32; shift += BITS ) {
+            histogram_pass.use();
+            keys_in->bind_base( 0 );
+            histogram.bind_base( 2 );
+            histogram_pass.set_uint( "count", (unsigned int) count );
+            histogram_pass.set_uint( "block_count", (unsigned int) blocks );
+            histogram_pass.set_uint( "shift", shift );
+            histogram_pass.dispatch_groups( blocks );
+            glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+
+            // digit major layout, so the scan hands out slots digit by digit
+            // and block by block within a digit
+            scan.exclusive_scan( ScanType::UINT, histogram, histogram, histogram_count );
+
+            scatter_pass.use();
+            keys_in->bind_base( 0 );
+            keys_out->bind_base( 1 );
+            histogram.bind_base( 2 );
+            values_in->bind_base( 3 );
+            values_out->bind_base( 4 );
+            scatter_pass.set_uint( "count", (unsigned int) count );
+            scatter_pass.set_uint( "block_count", (unsigned int) blocks );
+            scatter_pass.set_uint( "shift", shift );
+            scatter_pass.dispatch_groups( blocks );
+            glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+
+            std::swap( keys_in, keys_out );
+            std::swap( values_in, values_out );
+        }
+
+        // an even number of passes, so keys_in is the caller's buffer again
+    }
+};
+
+#endif
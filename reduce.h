@@ -0,0 +1,129 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "compute_program.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "storage_buffer.h"
+
+enum class ReduceOp {
+    SUM,
+    MIN,
+    MAX,
+};
+
+// sum/min/max/mean of a float buffer on the gpu, only the scalar result
+// comes back. each pass shrinks the input to one value per work group,
+// uses subgroup arithmetic when the driver has it, shared memory otherwise
+class Reduction {
+public:
+    // true when the kernels were built with subgroup operations
+    bool subgroups;
+
+    Reduction() {
+        subgroups = has_subgroup_arithmetic();
+        std::string base = subgroups ? "#define USE_SUBGROUPS 1\n" : "";
+
+        programs.emplace_back( "reduce.comp", base + "#define OP_SUM 1\n" );
+        programs.emplace_back( "reduce.comp", base + "#define OP_MIN 1\n" );
+        programs.emplace_back( "reduce.comp", base + "#define OP_MAX 1\n" );
+
+        // partial results ping pong between these, one float per group
+        scratch.emplace_back( "reduce scratch a", MAX_GROUPS * sizeof(float) );
+        scratch.emplace_back( "reduce scratch b", MAX_GROUPS * sizeof(float) );
+    }
+
+    // reduce the first count floats of input. blocks on the 4 byte readback
+    float reduce( ReduceOp op, StorageBuffer& input, size_t count ) {
+        if ( count == 0 ) {
+            return 0.0f;
+        }
+
+        StorageBuffer* result = run( op, input, count );
+        float value;
+        result->download( &value, sizeof(value) );
+        return value;
+    }
+
+    // reduce without reading the result back. the value is left in the
+    // first float of the returned buffer, for later kernels to use
+    StorageBuffer* run( ReduceOp op, StorageBuffer& input, size_t count ) {
+        ComputeProgram& program = programs[ (int) op ];
+        program.use();
+
+        StorageBuffer* source = &input;
+        int target = 0;
+
+        // at most MAX_GROUPS partials after the first pass, so two passes
+        // covers any size, the loop is just for generality
+        do {
+            unsigned int groups = group_count( count );
+
+            source->bind_base( 0 );
+            scratch[ target ].bind_base( 1 );
+            program.set_uint( "count", (unsigned int) count );
+            program.dispatch( groups );
+            glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+
+            source = &scratch[ target ];
+            target = 1 - target;
+            count = groups;
+        } while ( count > 1 );
+
+        return source;
+    }
+
+    float sum( StorageBuffer& input, size_t count ) {
+        return reduce( ReduceOp::SUM, input, count );
+    }
+
+    float min( StorageBuffer& input, size_t count ) {
+        return reduce( ReduceOp::MIN, input, count );
+    }
+
+    float max( StorageBuffer& input, size_t count ) {
+        return reduce( ReduceOp::MAX, input, count );
+    }
+
+    float mean( StorageBuffer& input, size_t count ) {
+        return count == 0 ? 0.0f : sum( input, count ) / count;
+    }
+
+private:
+    static const unsigned int LOCAL_SIZE = 256;
+    // each invocation folds at least this many elements before the tree
+    static const unsigned int ITEMS_PER_INVOCATION = 16;
+    static const unsigned int MAX_GROUPS = 1024;
+
+    std::vector<ComputeProgram> programs;
+    std::vector<StorageBuffer> scratch;
+
+    // the extension alone doesn't promise arithmetic ops, or any of them in
+    // compute shaders, so check the stages and features it reports
+    static bool has_subgroup_arithmetic() {
+        if ( !has_gl_extension( "GL_KHR_shader_subgroup" ) ) {
+            return false;
+        }
+
+        GLint stages = 0, features = 0;
+        glGetIntegerv( GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages );
+        glGetIntegerv( GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features );
+
+        GLint needed = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR;
+        return ( stages & GL_COMPUTE_SHADER_BIT ) != 0 && ( features & needed ) == needed;
+    }
+
+    static unsigned int group_count( size_t count ) {
+        size_t per_group = LOCAL_SIZE * ITEMS_PER_INVOCATION;
+        size_t groups = ( count + per_group - 1 ) / per_group;
+        return (unsigned int) std::max( (size_t) 1, std::min( groups, (size_t) MAX_GROUPS ) );
+    }
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "compute_program.h"
+#include "storage_buffer.h"
+
+enum class ScanType {
+    UINT,
+    FLOAT,
+};
+
+// gpu prefix sum over 32-bit uints or floats. reduce-then-scan: block
+// totals are reduced, scanned recursively with the same kernels, then every
+// block is scanned starting from its offset. that's three passes over the
+// data and one level of recursion per 2048x of size, so a few hundred
+// million elements is three levels
+class PrefixScan {
+public:
+    PrefixScan() {
+        programs.emplace_back( "scan.comp", "#define TYPE_UINT 1\n#define PASS_REDUCE 1\n" );
+        programs.emplace_back( "scan.comp", "#define TYPE_UINT 1\n#define PASS_SCAN 1\n" );
+        programs.emplace_back( "scan.comp", "#define TYPE_FLOAT 1\n#define PASS_REDUCE 1\n" );
+        programs.emplace_back( "scan.comp", "#define TYPE_FLOAT 1\n#define PASS_SCAN 1\n" );
+    }
+
+    // output may be the same buffer as input
+    void inclusive_scan( ScanType type, StorageBuffer& input, StorageBuffer& output, size_t count ) {
+        prepare_levels( count );
+        scan_level( type, input, output, count, false, 0 );
+    }
+
+    // output[ 0 ] is zero, output[ i ] is the sum of input[ 0 .. i - 1 ]
+    void exclusive_scan( ScanType type, StorageBuffer& input, StorageBuffer& output, size_t count ) {
+        prepare_levels( count );
+        scan_level( type, input, output, count, true, 0 );
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 256 * 8;
+
+    std::vector<ComputeProgram> programs;
+    // block totals for each level of recursion, kept between calls
+    std::vector<StorageBuffer> levels;
+
+    ComputeProgram& program( ScanType type, bool reduce ) {
+        return programs[ ( type == ScanType::FLOAT ? 2 : 0 ) + ( reduce ? 0 : 1 ) ];
+    }
+
+    // make sure every level's totals buffer exists and is big enough before
+    // recursing, growing the vector mid recursion would move them
+    void prepare_levels( size_t count ) {
+        int level = 0;
+        do {
+            size_t blocks = ( count + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+            size_t bytes = std::max( blocks, (size_t) 1 ) * sizeof(unsigned int);
+            std::string label = "scan block totals " + std::to_string( level );
+
+            if ( (int) levels.size() <= level ) {
+                levels.emplace_back( label, bytes );
+            } else if ( levels[ level ].size < bytes ) {
+                levels[ level ] = StorageBuffer( label, bytes );
+            }
+
+            count = blocks;
+            level++;
+        } while ( count > 1 );
+    }
+
+    void scan_level( ScanType type, StorageBuffer& input, StorageBuffer& output, size_t count, bool exclusive, int level ) {
+        if ( count == 0 ) {
+            return;
+        }
+
+        size_t blocks = ( count + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+        StorageBuffer& totals = levels[ level ];
+
+        if ( blocks > 1 ) {
+            ComputeProgram& reduce = program( type, true );
+            reduce.use();
+            input.bind_base( 0 );
+            totals.bind_base( 2 );
+            reduce.set_uint( "count", (unsigned int) count );
+            reduce.set_uint( "block_count", (unsigned int) blocks );
+            reduce.dispatch_groups( blocks );
+            glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+
+            // block offsets are the exclusive scan of the block totals
+            scan_level( type, totals, totals, blocks, true, level + 1 );
+        }
+
+        ComputeProgram& scan = program( type, false );
+        scan.use();
+        input.bind_base( 0 );
+        output.bind_base( 1 );
+        totals.bind_base( 2 );
+        scan.set_uint( "count", (unsigned int) count );
+        scan.set_uint( "block_count", (unsigned int) blocks );
+        scan.set_uint( "exclusive", exclusive ? 1 : 0 );
+        scan.set_uint( "has_offsets", blocks > 1 ? 1 : 0 );
+        scan.dispatch_groups( blocks );
+        glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+    }
+};
+
+#endif
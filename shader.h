@@ -3,15 +3,19 @@
 
 #include <glad/glad.h>
 
+#include "gl_handle.h"
+#include "gl_state.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// move only, the program is owned by its handle
 class Shader {
 public:
     // program id
-    unsigned int id;
+    ProgramHandle id;
 
     // constructor will read and build the shader
     Shader( const char* vertexPath, const char* fragmentPath ) {
@@ -59,37 +63,32 @@ public:
         glCompileShader( fragment );
 
         // shader program
-        id = glCreateProgram();
-        glAttachShader( id, vertex );
-        glAttachShader( id, fragment );
-        glLinkProgram( id );
+        id.reset( glCreateProgram() );
+        glAttachShader( id.get(), vertex );
+        glAttachShader( id.get(), fragment );
+        glLinkProgram( id.get() );
 
         // delete shaders as they are not needed anymore
         glDeleteShader( vertex );
         glDeleteShader( fragment );
     }
 
-    ~Shader() {
-        // delete program upon destruction of shader
-        glDeleteProgram( id );
-    }
-
     // use/activate the shader
     void use() {
-        glUseProgram( id );
+        gl_state().use_program( id.get() );
     }
 
     // utility uniform functions
     void setBool( const std::string &name, bool value ) const {
-        glUniform1i( glGetUniformLocation( id, name.c_str() ), (int) value );
+        glUniform1i( glGetUniformLocation( id.get(), name.c_str() ), (int) value );
     }
 
     void setInt( const std::string &name, int value ) const {
-        glUniform1i( glGetUniformLocation( id, name.c_str() ), value );
+        glUniform1i( glGetUniformLocation( id.get(), name.c_str() ), value );
     }
 
     void setFloat( const std::string &name, float value ) const {
-        glUniform1f( glGetUniformLocation( id, name.c_str() ), value );
+        glUniform1f( glGetUniformLocation( id.get(), name.c_str() ), value );
     }
 };
 
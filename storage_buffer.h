@@ -0,0 +1,62 @@
+#ifndef STORAGE_BUFFER_H
+#define STORAGE_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+#include <string>
+#include <vector>
+
+// a shader storage buffer of a fixed size in bytes. move only
+class StorageBuffer {
+public:
+    BufferHandle id;
+    size_t size;
+
+    StorageBuffer( const std::string& label, size_t bytes, const void* data = NULL, GLenum usage = GL_DYNAMIC_COPY ) {
+        id = make_buffer( label );
+        size = bytes;
+        gpu_memory().buffer_data( GL_SHADER_STORAGE_BUFFER, id.get(), bytes, data, usage );
+    }
+
+    // attach to an indexed binding, e.g. layout(binding = n) buffer in glsl
+    void bind_base( unsigned int binding, GLenum target = GL_SHADER_STORAGE_BUFFER ) {
+        gl_state().bind_buffer_base( target, binding, id.get() );
+    }
+
+    void upload( const void* data, size_t bytes, size_t offset = 0 ) {
+        gl_state().bind_buffer( GL_COPY_WRITE_BUFFER, id.get() );
+        glBufferSubData( GL_COPY_WRITE_BUFFER, offset, bytes, data );
+    }
+
+    // blocks until the gpu has finished writing the range
+    void download( void* data, size_t bytes, size_t offset = 0 ) {
+        gl_state().bind_buffer( GL_COPY_READ_BUFFER, id.get() );
+        glGetBufferSubData( GL_COPY_READ_BUFFER, offset, bytes, data );
+    }
+
+    template <typename T>
+    std::vector<T> read( size_t count, size_t first = 0 ) {
+        std::vector<T> values( count );
+        download( values.data(), count * sizeof(T), first * sizeof(T) );
+        return values;
+    }
+
+    // fill with a repeated 32-bit value, zero by default
+    void clear( unsigned int value = 0 ) {
+        gl_state().bind_buffer( GL_COPY_WRITE_BUFFER, id.get() );
+        glClearBufferData( GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &value );
+    }
+};
+
+// gpu side copy between two buffers
+void copy_buffer( StorageBuffer& source, StorageBuffer& destination, size_t bytes, size_t source_offset = 0, size_t destination_offset = 0 ) {
+    gl_state().bind_buffer( GL_COPY_READ_BUFFER, source.id.get() );
+    gl_state().bind_buffer( GL_COPY_WRITE_BUFFER, destination.id.get() );
+    glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source_offset, destination_offset, bytes );
+}
+
+#endif
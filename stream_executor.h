@@ -0,0 +1,139 @@
+#ifndef STREAM_EXECUTOR_H
+#define STREAM_EXECUTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "compute.h"
+#include "gl_handle.h"
+#include "gl_state.h"
+#include "storage_buffer.h"
+
+// runs a kernel over float data far bigger than one Compute, a chunk at a
+// time. three slots, each with its own Compute and pack/unpack buffers,
+// rotate so that while the cpu fills chunk n + 2's upload buffer the gpu
+// can still be stepping chunk n + 1 and packing chunk n for readback. the
+// cpu only waits on a slot's fence when it comes round again, so the
+// transfers and the compute overlap instead of adding up
+//
+// the kernel gets a double buffered r32f Compute, like shader.comp
+class StreamExecutor {
+public:
+    // times the cpu had to wait for the gpu to finish a chunk
+    unsigned int fence_waits;
+
+    StreamExecutor( const char* path, size_t chunk_texels, unsigned int steps = 1 ) {
+        this->steps = steps;
+        rows = (unsigned int) std::max( ( chunk_texels + WIDTH - 1 ) / WIDTH, (size_t) 1 );
+        fence_waits = 0;
+
+        slots.reserve( SLOT_COUNT );
+        for ( int i = 0; i < SLOT_COUNT; i++ ) {
+            slots.emplace_back( path, rows );
+        }
+    }
+
+    // output may not alias input. blocks until the last chunk is back
+    void run( const float* input, float* output, size_t count ) {
+        size_t chunk = chunk_texels();
+        size_t chunks = ( count + chunk - 1 ) / chunk;
+
+        for ( size_t c = 0; c < chunks; c++ ) {
+            Slot& slot = slots[ c % SLOT_COUNT ];
+            finish( slot, output );
+
+            slot.first = c * chunk;
+            slot.count = std::min( chunk, count - slot.first );
+            unsigned int chunk_rows = (unsigned int) ( ( slot.count + WIDTH - 1 ) / WIDTH );
+            size_t padded = (size_t) chunk_rows * WIDTH;
+
+            // the last chunk can be short, that fits in the storage
+            slot.compute.resize( glm::uvec2( WIDTH, chunk_rows ) );
+
+            // straight into the unpack buffer, the old contents are
+            // dropped so the driver doesn't wait for their last upload
+            gl_state().bind_buffer( GL_PIXEL_UNPACK_BUFFER, slot.upload.id.get() );
+            float* mapped = (float*) glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, padded * sizeof(float),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+            if ( mapped != NULL ) {
+                memcpy( mapped, input + slot.first, slot.count * sizeof(float) );
+                std::fill( mapped + slot.count, mapped + padded, 0.0f );
+                glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+            }
+
+            slot.compute.use();
+            slot.compute.set_values( (const float*) NULL );
+            gl_state().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+            slot.compute.step( steps );
+            slot.compute.wait( GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+            slot.compute.copy_to( slot.download );
+
+            slot.fence = make_fence();
+            glFlush();
+        }
+
+        // whatever is still in flight, oldest first
+        for ( size_t c = chunks > SLOT_COUNT ? chunks - SLOT_COUNT : 0; c < chunks; c++ ) {
+            finish( slots[ c % SLOT_COUNT ], output );
+        }
+    }
+
+    size_t chunk_texels() {
+        return (size_t) rows * WIDTH;
+    }
+
+private:
+    static const int SLOT_COUNT = 3;
+    static const unsigned int WIDTH = 1024;
+
+    struct Slot {
+        Compute compute;
+        StorageBuffer upload;
+        StorageBuffer download;
+        // set once the chunk's readback is queued
+        FenceHandle fence;
+        size_t first;
+        size_t count;
+
+        Slot( const char* path, unsigned int rows )
+            : compute( path, glm::uvec2( WIDTH, rows ), true ),
+              upload( "stream upload", (size_t) WIDTH * rows * sizeof(float), NULL, GL_STREAM_DRAW ),
+              download( "stream download", (size_t) WIDTH * rows * sizeof(float), NULL, GL_STREAM_READ ) {
+            first = count = 0;
+        }
+    };
+
+    std::vector<Slot> slots;
+    unsigned int rows;
+    unsigned int steps;
+
+    // copy a slot's finished chunk out, if it has one in flight
+    void finish( Slot& slot, float* output ) {
+        if ( !slot.fence ) {
+            return;
+        }
+
+        if ( glClientWaitSync( slot.fence.get(), 0, 0 ) == GL_TIMEOUT_EXPIRED ) {
+            fence_waits++;
+            glClientWaitSync( slot.fence.get(), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+        }
+        slot.fence.reset();
+
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, slot.download.id.get() );
+        const float* mapped = (const float*) glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, slot.count * sizeof(float),
+            GL_MAP_READ_BIT );
+        if ( mapped != NULL ) {
+            memcpy( output + slot.first, mapped, slot.count * sizeof(float) );
+            glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+        }
+        gl_state().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+    }
+};
+
+#endif